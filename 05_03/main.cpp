@@ -1,106 +1,691 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 #include <time.h>
 #include <omp.h>
+#include <unistd.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "../common/autotune.h"
 
-#define SIZE 100 
-#define ITERATIONS 10 
+#define DEFAULT_SIZE 100
+#define ITERATIONS 10
 #define ALIVE 'X'
 #define DEAD '.'
+#define TILE_SIZE 64
+#define RLE_LINE_LENGTH 70
+#define TUNE_GENERATIONS 10
 
-void initialize_grid(char **grid) {
-    srand(time(NULL));
-    for (int i = 0; i < SIZE; i++) {
-        for (int j = 0; j < SIZE; j++) {
-            grid[i][j] = (rand() % 2) ? ALIVE : DEAD;
+typedef enum { ENGINE_BYTES, ENGINE_PACKED } Engine;
+
+// Поле хранится либо по байту на клетку, либо по 64 клетки в слове uint64_t
+typedef struct {
+    Engine engine;
+    int size;
+    int words_per_row;
+    char **cells;
+    uint64_t *bits;
+} Grid;
+
+int grid_alloc(Grid *grid, Engine engine, int size) {
+    grid->engine = engine;
+    grid->size = size;
+    grid->words_per_row = (size + 63) / 64;
+    grid->cells = NULL;
+    grid->bits = NULL;
+    if (engine == ENGINE_PACKED) {
+        grid->bits = (uint64_t *)calloc((size_t)size * grid->words_per_row, sizeof(uint64_t));
+        return grid->bits != NULL;
+    }
+    grid->cells = (char **)calloc(size, sizeof(char *));
+    if (!grid->cells) return 0;
+    for (int i = 0; i < size; i++) {
+        grid->cells[i] = (char *)malloc(size * sizeof(char));
+        if (!grid->cells[i]) return 0;
+    }
+    return 1;
+}
+
+void grid_free(Grid *grid) {
+    if (grid->cells) {
+        for (int i = 0; i < grid->size; i++) {
+            free(grid->cells[i]);
         }
+        free(grid->cells);
+    }
+    free(grid->bits);
+    grid->cells = NULL;
+    grid->bits = NULL;
+}
+
+int get_cell(const Grid *grid, int i, int j) {
+    if (grid->engine == ENGINE_PACKED) {
+        uint64_t word = grid->bits[(size_t)i * grid->words_per_row + j / 64];
+        return (int)((word >> (j % 64)) & 1);
     }
+    return grid->cells[i][j] == ALIVE;
 }
 
-int count_neighbors(char **grid, int x, int y) {
+void set_cell(Grid *grid, int i, int j, int alive) {
+    if (grid->engine == ENGINE_PACKED) {
+        uint64_t *word = &grid->bits[(size_t)i * grid->words_per_row + j / 64];
+        uint64_t mask = (uint64_t)1 << (j % 64);
+        *word = alive ? (*word | mask) : (*word & ~mask);
+        return;
+    }
+    grid->cells[i][j] = alive ? ALIVE : DEAD;
+}
+
+// density - доля живых клеток в процентах
+void initialize_grid(Grid *grid, int density) {
+    for (int i = 0; i < grid->size; i++) {
+        for (int j = 0; j < grid->size; j++) {
+            set_cell(grid, i, j, rand() % 100 < density);
+        }
+    }
+}
+
+void copy_grid(const Grid *src, Grid *dst) {
+    for (int i = 0; i < src->size; i++) {
+        for (int j = 0; j < src->size; j++) {
+            set_cell(dst, i, j, get_cell(src, i, j));
+        }
+    }
+}
+
+// Копия поля того же движка без поклеточного доступа
+void copy_grid_raw(const Grid *src, Grid *dst) {
+    if (src->engine == ENGINE_PACKED) {
+        memcpy(dst->bits, src->bits, (size_t)src->size * src->words_per_row * sizeof(uint64_t));
+        return;
+    }
+    for (int i = 0; i < src->size; i++) {
+        memcpy(dst->cells[i], src->cells[i], src->size);
+    }
+}
+
+TuneCache tune_cache;
+
+// Настройки ядер для текущего размера поля; по умолчанию - прежние ручные
+TuneConfig bytes_config = { 0, omp_sched_dynamic, 0, 0 };
+TuneConfig packed_config = { 0, omp_sched_static, 0, 0 };
+TuneConfig tiled_config = { 0, omp_sched_dynamic, 0, TILE_SIZE };
+
+int count_neighbors(char **grid, int size, int x, int y) {
     int count = 0;
     for (int i = -1; i <= 1; i++) {
         for (int j = -1; j <= 1; j++) {
             if (i == 0 && j == 0) continue;
-            int ni = (x + i + SIZE) % SIZE;
-            int nj = (y + j + SIZE) % SIZE;
+            int ni = (x + i + size) % size;
+            int nj = (y + j + size) % size;
             if (grid[ni][nj] == ALIVE) count++;
         }
     }
     return count;
 }
 
-void update_grid(char **current, char **next) {
-    #pragma omp parallel for collapse(2) schedule(dynamic)
-    for (int i = 0; i < SIZE; i++) {
-        for (int j = 0; j < SIZE; j++) {
-            int neighbors = count_neighbors(current, i, j);
-            if (current[i][j] == ALIVE) {
-                next[i][j] = (neighbors == 2 || neighbors == 3) ? ALIVE : DEAD;
-            } else {
-                next[i][j] = (neighbors == 3) ? ALIVE : DEAD;
+static inline char next_cell(char **current, int size, int i, int j) {
+    int neighbors = count_neighbors(current, size, i, j);
+    if (current[i][j] == ALIVE) {
+        return (neighbors == 2 || neighbors == 3) ? ALIVE : DEAD;
+    }
+    return (neighbors == 3) ? ALIVE : DEAD;
+}
+
+void update_grid_bytes(char **current, char **next, int size) {
+    omp_set_schedule(bytes_config.schedule, bytes_config.chunk);
+    #pragma omp parallel for collapse(2) schedule(runtime) num_threads(config_threads(bytes_config))
+    for (int i = 0; i < size; i++) {
+        for (int j = 0; j < size; j++) {
+            next[i][j] = next_cell(current, size, i, j);
+        }
+    }
+}
+
+// Обновляет прямоугольник [i0, i1) x [j0, j1), возвращает 1, если хоть одна клетка изменилась
+int update_tile_bytes(char **current, char **next, int size, int i0, int i1, int j0, int j1) {
+    int changed = 0;
+    for (int i = i0; i < i1; i++) {
+        for (int j = j0; j < j1; j++) {
+            next[i][j] = next_cell(current, size, i, j);
+            changed |= (next[i][j] != current[i][j]);
+        }
+    }
+    return changed;
+}
+
+// Соседи слева/справа для слова w строки с переносом через край тора.
+// Бит j слова w соответствует столбцу 64 * w + j, хвост последнего слова всегда нулевой.
+static inline uint64_t west_word(const uint64_t *row, int w, int words, int size) {
+    uint64_t carry = (w > 0) ? (row[w - 1] >> 63)
+                             : ((row[words - 1] >> ((size - 1) % 64)) & 1);
+    return (row[w] << 1) | carry;
+}
+
+static inline uint64_t east_word(const uint64_t *row, int w, int words, int size) {
+    uint64_t carry = (w < words - 1) ? (row[w + 1] << 63)
+                                     : ((row[0] & 1) << ((size - 1) % 64));
+    return (row[w] >> 1) | carry;
+}
+
+static inline void full_add(uint64_t a, uint64_t b, uint64_t c, uint64_t *sum, uint64_t *carry) {
+    uint64_t t = a ^ b;
+    *sum = t ^ c;
+    *carry = (a & b) | (t & c);
+}
+
+// Следующее поколение 64 клеток: побитовый сумматор восьми соседей
+static inline uint64_t next_word(uint64_t nw, uint64_t n, uint64_t ne,
+                                 uint64_t w, uint64_t alive, uint64_t e,
+                                 uint64_t sw, uint64_t s, uint64_t se) {
+    uint64_t s_a, c_a, s_b, c_b, ones, c_d, t0, t1;
+    full_add(nw, n, ne, &s_a, &c_a);
+    full_add(w, e, sw, &s_b, &c_b);
+    uint64_t s_c = s ^ se;
+    uint64_t c_c = s & se;
+    full_add(s_a, s_b, s_c, &ones, &c_d);
+    // Сумма = ones + 2 * (c_a + c_b + c_c + c_d); нужны ровно две или три живых клетки
+    full_add(c_a, c_b, c_c, &t0, &t1);
+    uint64_t twos_is_one = ~t1 & (t0 ^ c_d);
+    return twos_is_one & (ones | alive);
+}
+
+// Обновляет строки [i0, i1) в словах [w0, w1), возвращает 1, если хоть одна клетка изменилась
+int update_tile_packed(const uint64_t *current, uint64_t *next, int size, int words,
+                       int i0, int i1, int w0, int w1) {
+    uint64_t tail_mask = (size % 64) ? (((uint64_t)1 << (size % 64)) - 1) : ~(uint64_t)0;
+    uint64_t diff = 0;
+    for (int i = i0; i < i1; i++) {
+        const uint64_t *up = current + (size_t)((i - 1 + size) % size) * words;
+        const uint64_t *row = current + (size_t)i * words;
+        const uint64_t *down = current + (size_t)((i + 1) % size) * words;
+        uint64_t *out = next + (size_t)i * words;
+        for (int w = w0; w < w1; w++) {
+            out[w] = next_word(west_word(up, w, words, size), up[w], east_word(up, w, words, size),
+                               west_word(row, w, words, size), row[w], east_word(row, w, words, size),
+                               west_word(down, w, words, size), down[w], east_word(down, w, words, size));
+            if (w == words - 1) out[w] &= tail_mask;
+            diff |= out[w] ^ row[w];
+        }
+    }
+    return diff != 0;
+}
+
+void update_grid_packed(const uint64_t *current, uint64_t *next, int size, int words) {
+    omp_set_schedule(packed_config.schedule, packed_config.chunk);
+    #pragma omp parallel for schedule(runtime) num_threads(config_threads(packed_config))
+    for (int i = 0; i < size; i++) {
+        update_tile_packed(current, next, size, words, i, i + 1, 0, words);
+    }
+}
+
+// Плитки tile x tile клеток (tiled_config.tile, кратно 64, чтобы плитки упакованного поля не делили слова);
+// обновляются только изменившиеся в прошлом поколении и их соседи.
+// Пропущенная плитка не менялась в прошлом поколении, поэтому в next уже лежит её текущее состояние.
+typedef struct {
+    int tile;
+    int tiles_per_side;
+    int count;
+    unsigned char *changed;
+    unsigned char *new_changed;
+    unsigned char *dirty;
+    int *worklist;
+    int active;
+} TileTracker;
+
+int tracker_alloc(TileTracker *tracker, int size) {
+    tracker->tile = tiled_config.tile > 0 ? tiled_config.tile : TILE_SIZE;
+    tracker->tiles_per_side = (size + tracker->tile - 1) / tracker->tile;
+    tracker->count = tracker->tiles_per_side * tracker->tiles_per_side;
+    tracker->changed = (unsigned char *)malloc(tracker->count);
+    tracker->new_changed = (unsigned char *)malloc(tracker->count);
+    tracker->dirty = (unsigned char *)malloc(tracker->count);
+    tracker->worklist = (int *)malloc(tracker->count * sizeof(int));
+    tracker->active = tracker->count;
+    if (!tracker->changed || !tracker->new_changed || !tracker->dirty || !tracker->worklist) return 0;
+    // Первое поколение считается целиком
+    memset(tracker->changed, 1, tracker->count);
+    return 1;
+}
+
+void tracker_free(TileTracker *tracker) {
+    free(tracker->changed);
+    free(tracker->new_changed);
+    free(tracker->dirty);
+    free(tracker->worklist);
+}
+
+void build_worklist(TileTracker *tracker) {
+    int n = tracker->tiles_per_side;
+    memset(tracker->dirty, 0, tracker->count);
+    for (int ti = 0; ti < n; ti++) {
+        for (int tj = 0; tj < n; tj++) {
+            if (!tracker->changed[ti * n + tj]) continue;
+            for (int di = -1; di <= 1; di++) {
+                for (int dj = -1; dj <= 1; dj++) {
+                    tracker->dirty[((ti + di + n) % n) * n + (tj + dj + n) % n] = 1;
+                }
             }
         }
     }
+    tracker->active = 0;
+    for (int t = 0; t < tracker->count; t++) {
+        if (tracker->dirty[t]) tracker->worklist[tracker->active++] = t;
+    }
 }
 
-void print_grid(char **grid) {
-    for (int i = 0; i < SIZE; i++) {
-        for (int j = 0; j < SIZE; j++) {
-            printf("%c", grid[i][j]);
+void update_grid_tiled(const Grid *current, Grid *next, TileTracker *tracker) {
+    int size = current->size;
+    int n = tracker->tiles_per_side;
+    build_worklist(tracker);
+    memset(tracker->new_changed, 0, tracker->count);
+
+    int tile = tracker->tile;
+    omp_set_schedule(tiled_config.schedule, tiled_config.chunk);
+    #pragma omp parallel for schedule(runtime) num_threads(config_threads(tiled_config))
+    for (int k = 0; k < tracker->active; k++) {
+        int t = tracker->worklist[k];
+        int i0 = (t / n) * tile;
+        int j0 = (t % n) * tile;
+        int i1 = (i0 + tile < size) ? i0 + tile : size;
+        int j1 = (j0 + tile < size) ? j0 + tile : size;
+        if (current->engine == ENGINE_PACKED) {
+            tracker->new_changed[t] = update_tile_packed(current->bits, next->bits, size, current->words_per_row,
+                                                         i0, i1, j0 / 64, (j1 + 63) / 64);
+        } else {
+            tracker->new_changed[t] = update_tile_bytes(current->cells, next->cells, size, i0, i1, j0, j1);
         }
-        printf("\n");
     }
-    printf("\n");
+
+    unsigned char *temp = tracker->changed;
+    tracker->changed = tracker->new_changed;
+    tracker->new_changed = temp;
+}
+
+void update_grid(const Grid *current, Grid *next, TileTracker *tracker) {
+    if (tracker) {
+        update_grid_tiled(current, next, tracker);
+    } else if (current->engine == ENGINE_PACKED) {
+        update_grid_packed(current->bits, next->bits, current->size, current->words_per_row);
+    } else {
+        update_grid_bytes(current->cells, next->cells, current->size);
+    }
 }
 
-void swap_grids(char ***current, char ***next) {
-    char **temp = *current;
+void swap_grids(Grid *current, Grid *next) {
+    Grid temp = *current;
     *current = *next;
     *next = temp;
 }
 
-int main() {
-    char **grid = (char **)malloc(SIZE * sizeof(char *));
-    char **next_grid = (char **)malloc(SIZE * sizeof(char *));
-    if (!grid || !next_grid) {
+int grids_equal(const Grid *a, const Grid *b) {
+    for (int i = 0; i < a->size; i++) {
+        for (int j = 0; j < a->size; j++) {
+            if (get_cell(a, i, j) != get_cell(b, i, j)) return 0;
+        }
+    }
+    return 1;
+}
+
+// Длина серии одинаковых клеток в строке i начиная со столбца j; упакованное поле идёт словами
+static int run_length(const Grid *grid, int i, int j, int alive) {
+    int end = j + 1;
+    if (grid->engine == ENGINE_PACKED) {
+        const uint64_t *row = grid->bits + (size_t)i * grid->words_per_row;
+        while (end < grid->size) {
+            uint64_t word = (alive ? ~row[end / 64] : row[end / 64]) >> (end % 64);
+            if (word) {
+                end += __builtin_ctzll(word);
+                break;
+            }
+            end += 64 - end % 64;
+        }
+        return (end < grid->size ? end : grid->size) - j;
+    }
+    while (end < grid->size && get_cell(grid, i, end) == alive) end++;
+    return end - j;
+}
+
+static void rle_append_run(FILE *file, char tag, int count, int *column) {
+    char token[16];
+    int length = (count > 1) ? snprintf(token, sizeof(token), "%d%c", count, tag)
+                             : snprintf(token, sizeof(token), "%c", tag);
+    if (*column + length > RLE_LINE_LENGTH) {
+        fputc('\n', file);
+        *column = 0;
+    }
+    fwrite(token, 1, length, file);
+    *column += length;
+}
+
+// Кадр в стандартном формате RLE для «Жизни»: b - мёртвая, o - живая, $ - конец строки, ! - конец кадра
+long long write_rle_frame(FILE *file, const Grid *grid, int generation) {
+    long start = ftell(file);
+    fprintf(file, "#C generation %d\nx = %d, y = %d, rule = B3/S23\n", generation, grid->size, grid->size);
+    int column = 0;
+    int pending_rows = 0;
+    for (int i = 0; i < grid->size; i++) {
+        int j = 0;
+        int row_started = 0;
+        while (j < grid->size) {
+            int alive = get_cell(grid, i, j);
+            int run = run_length(grid, i, j, alive);
+            // Хвост из мёртвых клеток в конце строки не записывается
+            if (alive || j + run < grid->size) {
+                if (!row_started && pending_rows > 0) {
+                    rle_append_run(file, '$', pending_rows, &column);
+                    pending_rows = 0;
+                }
+                row_started = 1;
+                rle_append_run(file, alive ? 'o' : 'b', run, &column);
+            }
+            j += run;
+        }
+        pending_rows++;
+    }
+    fputs("!\n", file);
+    return ftell(file) - start;
+}
+
+// Кадры копируются из основного цикла в буфер и записываются отдельным потоком
+typedef struct {
+    FILE *file;
+    Grid pending;
+    Grid writing;
+    int pending_generation;
+    bool has_pending;
+    bool stop;
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::thread writer;
+    double snapshot_time;
+    double io_time;
+    int frames;
+    long long bytes;
+} SnapshotSink;
+
+void sink_writer(SnapshotSink *sink) {
+    for (;;) {
+        int generation;
+        {
+            std::unique_lock<std::mutex> lock(sink->mtx);
+            sink->cv.wait(lock, [sink] { return sink->has_pending || sink->stop; });
+            if (!sink->has_pending) return;
+            swap_grids(&sink->pending, &sink->writing);
+            generation = sink->pending_generation;
+            sink->has_pending = false;
+        }
+        sink->cv.notify_all();
+
+        double start = omp_get_wtime();
+        sink->bytes += write_rle_frame(sink->file, &sink->writing, generation);
+        sink->io_time += omp_get_wtime() - start;
+        sink->frames++;
+    }
+}
+
+int sink_open(SnapshotSink *sink, const char *path, Engine engine, int size) {
+    sink->file = fopen(path, "wb");
+    if (!sink->file) return 0;
+    setvbuf(sink->file, NULL, _IOFBF, 1 << 20);
+    if (!grid_alloc(&sink->pending, engine, size) || !grid_alloc(&sink->writing, engine, size)) return 0;
+    sink->has_pending = false;
+    sink->stop = false;
+    sink->snapshot_time = 0.0;
+    sink->io_time = 0.0;
+    sink->frames = 0;
+    sink->bytes = 0;
+    sink->writer = std::thread(sink_writer, sink);
+    return 1;
+}
+
+// Если писатель ещё не забрал предыдущий кадр, основной цикл ждёт; это время входит в snapshot_time
+void sink_submit(SnapshotSink *sink, const Grid *grid, int generation) {
+    double start = omp_get_wtime();
+    {
+        std::unique_lock<std::mutex> lock(sink->mtx);
+        sink->cv.wait(lock, [sink] { return !sink->has_pending; });
+        copy_grid_raw(grid, &sink->pending);
+        sink->pending_generation = generation;
+        sink->has_pending = true;
+    }
+    sink->cv.notify_all();
+    sink->snapshot_time += omp_get_wtime() - start;
+}
+
+void sink_close(SnapshotSink *sink) {
+    {
+        std::lock_guard<std::mutex> lock(sink->mtx);
+        sink->stop = true;
+    }
+    sink->cv.notify_all();
+    sink->writer.join();
+    double start = omp_get_wtime();
+    fclose(sink->file);
+    sink->io_time += omp_get_wtime() - start;
+    grid_free(&sink->pending);
+    grid_free(&sink->writing);
+}
+
+// Проверка: все движки (с плитками и без) из одного начального поля должны давать одинаковые поколения
+int verify_engines(int size, int iterations, int density) {
+    const int variants = 4;
+    const Engine engines[variants] = { ENGINE_BYTES, ENGINE_PACKED, ENGINE_BYTES, ENGINE_PACKED };
+    const int tiled[variants] = { 0, 0, 1, 1 };
+    const char *names[variants] = { "bytes", "packed", "bytes+tiles", "packed+tiles" };
+    Grid grids[variants], next_grids[variants];
+    TileTracker trackers[variants];
+
+    for (int v = 0; v < variants; v++) {
+        if (!grid_alloc(&grids[v], engines[v], size) || !grid_alloc(&next_grids[v], engines[v], size) ||
+            (tiled[v] && !tracker_alloc(&trackers[v], size))) {
+            fprintf(stderr, "Memory allocation failed\n");
+            return 1;
+        }
+    }
+
+    initialize_grid(&grids[0], density);
+    for (int v = 1; v < variants; v++) {
+        copy_grid(&grids[0], &grids[v]);
+    }
+
+    int correct = 1;
+    for (int iter = 0; iter < iterations && correct; iter++) {
+        for (int v = 0; v < variants; v++) {
+            update_grid(&grids[v], &next_grids[v], tiled[v] ? &trackers[v] : NULL);
+            swap_grids(&grids[v], &next_grids[v]);
+        }
+        for (int v = 1; v < variants; v++) {
+            if (!grids_equal(&grids[0], &grids[v])) {
+                printf("Generation %d differs for engine %s\n", iter + 1, names[v]);
+                correct = 0;
+            }
+        }
+    }
+    if (tiled[variants - 1]) {
+        printf("Active tiles in last generation: %d of %d\n",
+               trackers[variants - 1].active, trackers[variants - 1].count);
+    }
+    printf("Results match: %s\n", correct ? "Yes" : "No");
+
+    for (int v = 0; v < variants; v++) {
+        grid_free(&grids[v]);
+        grid_free(&next_grids[v]);
+        if (tiled[v]) tracker_free(&trackers[v]);
+    }
+    return correct ? 0 : 1;
+}
+
+// TUNE_GENERATIONS поколений с текущими настройками на поле из фиксированного seed
+static void run_generations(Engine engine, int tiled, int size, int density) {
+    Grid grid, next_grid;
+    TileTracker tracker;
+    if (!grid_alloc(&grid, engine, size) || !grid_alloc(&next_grid, engine, size) ||
+        (tiled && !tracker_alloc(&tracker, size))) {
         fprintf(stderr, "Memory allocation failed\n");
+        exit(1);
+    }
+    srand(12345);
+    initialize_grid(&grid, density);
+    for (int iter = 0; iter < TUNE_GENERATIONS; iter++) {
+        update_grid(&grid, &next_grid, tiled ? &tracker : NULL);
+        swap_grids(&grid, &next_grid);
+    }
+    grid_free(&grid);
+    grid_free(&next_grid);
+    if (tiled) tracker_free(&tracker);
+}
+
+// Ядро читает настройки из глобальной структуры, поэтому кандидат пишется прямо в *config
+void autotune_kernel(const char *kernel, TuneConfig *config, Engine engine, int tiled, int size, int density) {
+    TuneSpace space;
+    if (tiled) space.tiles = { 64, 128, 256 };
+    *config = autotune(kernel, *config, space, [&](const TuneConfig &candidate) {
+        *config = candidate;
+        run_generations(engine, tiled, size, density);
+    });
+}
+
+int main(int argc, char **argv) {
+    int size = DEFAULT_SIZE;
+    int iterations = ITERATIONS;
+    Engine engine = ENGINE_BYTES;
+    int density = 50;
+    int tiles = 0;
+    int verify = 0;
+    int silent = 0;
+    const char *output_path = NULL;
+    int interval = 5;
+    int tune = 0;
+    tune_cache.path = default_tune_path("game_of_life");
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            size = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--engine") == 0 && i + 1 < argc) {
+            engine = (strcmp(argv[++i], "packed") == 0) ? ENGINE_PACKED : ENGINE_BYTES;
+        } else if (strcmp(argv[i], "--density") == 0 && i + 1 < argc) {
+            density = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--tiles") == 0) {
+            tiles = 1;
+        } else if (strcmp(argv[i], "--verify") == 0) {
+            verify = 1;
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output_path = argv[++i];
+        } else if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+            interval = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--silent") == 0) {
+            silent = 1;
+        } else if (strcmp(argv[i], "--tune") == 0) {
+            tune = 1;
+        } else if (strcmp(argv[i], "--tune-file") == 0 && i + 1 < argc) {
+            tune_cache.path = argv[++i];
+        } else {
+            fprintf(stderr, "Usage: %s [--size N] [--iterations N] [--density PERCENT] [--engine bytes|packed] [--tiles] [--verify]\n"
+                            "       [--output FILE.rle] [--interval N] [--silent] [--tune] [--tune-file FILE]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (size < 3 || iterations < 0 || interval < 1) {
+        fprintf(stderr, "Invalid board size or iteration count\n");
         return 1;
     }
-    for (int i = 0; i < SIZE; i++) {
-        grid[i] = (char *)malloc(SIZE * sizeof(char));
-        next_grid[i] = (char *)malloc(SIZE * sizeof(char));
-        if (!grid[i] || !next_grid[i]) {
-            fprintf(stderr, "Memory allocation failed for row %d\n", i);
+
+    // Рабочие запуски берут подобранные настройки из файла машины; --tune подбирает их для этого размера и дописывает файл
+    if (tune_cache.load()) {
+        printf("Loaded %zu tuned configurations from %s\n", tune_cache.size(), tune_cache.path.c_str());
+    }
+    bytes_config = tune_cache.lookup("bytes", size, bytes_config);
+    packed_config = tune_cache.lookup("packed", size, packed_config);
+    // Плитки подбираются отдельно для каждого движка; размер из файла округляется вверх до кратного 64
+    const char *tiled_kernel = (engine == ENGINE_PACKED) ? "tiled_packed" : "tiled_bytes";
+    tiled_config = tune_cache.lookup(tiled_kernel, size, tiled_config);
+    if (tiled_config.tile < 0) tiled_config.tile = 0;
+    tiled_config.tile = (tiled_config.tile + 63) / 64 * 64;
+    if (tune) {
+        autotune_kernel("bytes", &bytes_config, ENGINE_BYTES, 0, size, density);
+        autotune_kernel("packed", &packed_config, ENGINE_PACKED, 0, size, density);
+        autotune_kernel(tiled_kernel, &tiled_config, engine, 1, size, density);
+        tune_cache.store("bytes", size, bytes_config);
+        tune_cache.store("packed", size, packed_config);
+        tune_cache.store(tiled_kernel, size, tiled_config);
+        if (!tune_cache.save()) {
+            fprintf(stderr, "Failed to write %s\n", tune_cache.path.c_str());
             return 1;
         }
+        printf("Saved tuning for size bucket %d to %s\n", size_bucket(size), tune_cache.path.c_str());
+    }
+
+    srand(time(NULL));
+
+    if (verify) {
+        return verify_engines(size, iterations, density);
     }
 
-    initialize_grid(grid);
+    Grid grid, next_grid;
+    if (!grid_alloc(&grid, engine, size) || !grid_alloc(&next_grid, engine, size)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return 1;
+    }
+    TileTracker tracker;
+    if (tiles && !tracker_alloc(&tracker, size)) {
+        fprintf(stderr, "Memory allocation failed\n");
+        return 1;
+    }
+
+    // В режиме --silent кадры не пишутся и ничего не печатается внутри цикла
+    SnapshotSink sink;
+    int snapshots = output_path && !silent;
+    if (snapshots && !sink_open(&sink, output_path, engine, size)) {
+        fprintf(stderr, "Failed to open snapshot output %s\n", output_path);
+        return 1;
+    }
 
+    initialize_grid(&grid, density);
+
+    long long active_total = 0;
+    double compute_time = 0.0;
     double start_time = omp_get_wtime();
 
     // Основной цикл
-    for (int iter = 0; iter < ITERATIONS; iter++) {
-        printf("Starting iteration %d\n", iter);
-        if (iter % 5 == 0) { 
-            system("cls"); 
-            printf("Iteration %d:\n", iter);
-            print_grid(grid);
-        }
-        update_grid(grid, next_grid);
+    for (int iter = 0; iter < iterations; iter++) {
+        if (snapshots && iter % interval == 0) {
+            sink_submit(&sink, &grid, iter);
+        }
+        double step_start = omp_get_wtime();
+        update_grid(&grid, &next_grid, tiles ? &tracker : NULL);
+        double step_time = omp_get_wtime() - step_start;
+        compute_time += step_time;
         swap_grids(&grid, &next_grid);
+        if (tiles) active_total += tracker.active;
+        if (!silent) {
+            if (tiles) {
+                printf("Generation %d: %f seconds, active tiles %d of %d\n", iter, step_time, tracker.active, tracker.count);
+            } else {
+                printf("Generation %d: %f seconds\n", iter, step_time);
+            }
+        }
     }
 
     double end_time = omp_get_wtime();
     printf("Execution time: %f seconds\n", end_time - start_time);
-
-    for (int i = 0; i < SIZE; i++) {
-        free(grid[i]);
-        free(next_grid[i]);
+    printf("Compute time: %f seconds\n", compute_time);
+    if (snapshots) {
+        sink_close(&sink);
+        printf("Snapshot copy time: %f seconds\n", sink.snapshot_time);
+        printf("Writer I/O time: %f seconds (%d frames, %lld bytes)\n", sink.io_time, sink.frames, sink.bytes);
+    }
+    if (tiles && iterations > 0) {
+        printf("Average active tiles: %.1f of %d\n", (double)active_total / iterations, tracker.count);
+        tracker_free(&tracker);
     }
-    free(grid);
-    free(next_grid);
+
+    grid_free(&grid);
+    grid_free(&next_grid);
 
     return 0;
-}
\ No newline at end of file
+}
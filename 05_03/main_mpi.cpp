@@ -0,0 +1,340 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include <mpi.h>
+
+#define DEFAULT_SIZE 100
+#define ITERATIONS 10
+
+// Направления соседей в декартовой решётке процессов
+enum { DIR_N, DIR_S, DIR_W, DIR_E, DIR_NW, DIR_NE, DIR_SW, DIR_SE, DIRECTIONS };
+static const int OPPOSITE[DIRECTIONS] = { DIR_S, DIR_N, DIR_E, DIR_W, DIR_SE, DIR_SW, DIR_NE, DIR_NW };
+static const int OFFSET[DIRECTIONS][2] = { {-1, 0}, {1, 0}, {0, -1}, {0, 1}, {-1, -1}, {-1, 1}, {1, -1}, {1, 1} };
+
+// Начальное поле задаётся хешем глобальных координат, поэтому каждый ранг строит свой блок сам
+static inline int initial_cell(uint64_t seed, int64_t i, int64_t j, int density) {
+    uint64_t z = seed + (uint64_t)i * 0x9E3779B97F4A7C15ULL + (uint64_t)j * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    return (int)(z % 100) < density;
+}
+
+void block_range(int n, int parts, int index, int *start, int *count) {
+    *count = n / parts + (index < n % parts);
+    *start = index * (n / parts) + (index < n % parts ? index : n % parts);
+}
+
+// Блок ранга хранится с рамкой призрачных клеток шириной 1: (rows + 2) x (cols + 2)
+typedef struct {
+    int rows, cols;
+    int row0, col0;
+    std::vector<char> cells;
+} Block;
+
+static inline char *cell(Block &block, int r, int c) {
+    return &block.cells[(size_t)r * (block.cols + 2) + c];
+}
+
+static inline char next_state(const char *cells, int stride, int r, int c) {
+    const char *up = cells + (size_t)(r - 1) * stride + c;
+    const char *mid = up + stride;
+    const char *down = mid + stride;
+    int neighbors = up[-1] + up[0] + up[1] + mid[-1] + mid[1] + down[-1] + down[0] + down[1];
+    return mid[0] ? (neighbors == 2 || neighbors == 3) : (neighbors == 3);
+}
+
+void update_cells(const Block &current, Block &next, int r0, int r1, int c0, int c1) {
+    int stride = current.cols + 2;
+    for (int r = r0; r <= r1; r++) {
+        for (int c = c0; c <= c1; c++) {
+            next.cells[(size_t)r * stride + c] = next_state(current.cells.data(), stride, r, c);
+        }
+    }
+}
+
+// Граничные клетки блока зависят от призрачных и считаются после завершения обмена
+void update_border(const Block &current, Block &next) {
+    int rows = current.rows, cols = current.cols;
+    update_cells(current, next, 1, 1, 1, cols);
+    if (rows > 1) update_cells(current, next, rows, rows, 1, cols);
+    if (rows > 2) {
+        update_cells(current, next, 2, rows - 1, 1, 1);
+        if (cols > 1) update_cells(current, next, 2, rows - 1, cols, cols);
+    }
+}
+
+typedef struct {
+    MPI_Comm comm;
+    int neighbors[DIRECTIONS];
+    MPI_Datatype row_type;
+    MPI_Datatype col_type;
+} Halo;
+
+void halo_create(Halo *halo, MPI_Comm cart, const Block &block) {
+    int rank, coords[2];
+    halo->comm = cart;
+    MPI_Comm_rank(cart, &rank);
+    MPI_Cart_coords(cart, rank, 2, coords);
+    for (int d = 0; d < DIRECTIONS; d++) {
+        int neighbor_coords[2] = { coords[0] + OFFSET[d][0], coords[1] + OFFSET[d][1] };
+        // Решётка периодическая, MPI_Cart_rank сам сворачивает координаты по модулю
+        MPI_Cart_rank(cart, neighbor_coords, &halo->neighbors[d]);
+    }
+    MPI_Type_contiguous(block.cols, MPI_CHAR, &halo->row_type);
+    MPI_Type_vector(block.rows, 1, block.cols + 2, MPI_CHAR, &halo->col_type);
+    MPI_Type_commit(&halo->row_type);
+    MPI_Type_commit(&halo->col_type);
+}
+
+void halo_free(Halo *halo) {
+    MPI_Type_free(&halo->row_type);
+    MPI_Type_free(&halo->col_type);
+}
+
+// Отправка краёв блока и приём призрачных клеток без блокировки; тег - направление отправки
+void halo_start(Halo *halo, Block &block, MPI_Request *requests) {
+    int rows = block.rows, cols = block.cols;
+    char *send[DIRECTIONS] = {
+        cell(block, 1, 1), cell(block, rows, 1), cell(block, 1, 1), cell(block, 1, cols),
+        cell(block, 1, 1), cell(block, 1, cols), cell(block, rows, 1), cell(block, rows, cols)
+    };
+    char *recv[DIRECTIONS] = {
+        cell(block, 0, 1), cell(block, rows + 1, 1), cell(block, 1, 0), cell(block, 1, cols + 1),
+        cell(block, 0, 0), cell(block, 0, cols + 1), cell(block, rows + 1, 0), cell(block, rows + 1, cols + 1)
+    };
+    for (int d = 0; d < DIRECTIONS; d++) {
+        MPI_Datatype type = (d == DIR_N || d == DIR_S) ? halo->row_type
+                          : (d == DIR_W || d == DIR_E) ? halo->col_type : MPI_CHAR;
+        MPI_Irecv(recv[d], 1, type, halo->neighbors[d], OPPOSITE[d], halo->comm, &requests[d]);
+        MPI_Isend(send[d], 1, type, halo->neighbors[d], d, halo->comm, &requests[DIRECTIONS + d]);
+    }
+}
+
+// Эталон: одно поле на одном процессе с тем же переносом через край, что и count_neighbors
+void update_sequential(const std::vector<char> &current, std::vector<char> &next, int rows, int cols) {
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            int count = 0;
+            for (int di = -1; di <= 1; di++) {
+                for (int dj = -1; dj <= 1; dj++) {
+                    if (di == 0 && dj == 0) continue;
+                    count += current[(size_t)((i + di + rows) % rows) * cols + (j + dj + cols) % cols];
+                }
+            }
+            char alive = current[(size_t)i * cols + j];
+            next[(size_t)i * cols + j] = alive ? (count == 2 || count == 3) : (count == 3);
+        }
+    }
+}
+
+double run_sequential(std::vector<char> &board, int rows, int cols, int iterations) {
+    std::vector<char> next(board.size());
+    double start = MPI_Wtime();
+    for (int iter = 0; iter < iterations; iter++) {
+        update_sequential(board, next, rows, cols);
+        board.swap(next);
+    }
+    return MPI_Wtime() - start;
+}
+
+// Тот же блочный код на одном процессе: рамка заполняется копированием противоположных краёв
+double run_block_sequential(Block &block, int iterations) {
+    Block next = block;
+    int rows = block.rows, cols = block.cols;
+    double start = MPI_Wtime();
+    for (int iter = 0; iter < iterations; iter++) {
+        for (int r = 1; r <= rows; r++) {
+            *cell(block, r, 0) = *cell(block, r, cols);
+            *cell(block, r, cols + 1) = *cell(block, r, 1);
+        }
+        memcpy(cell(block, 0, 0), cell(block, rows, 0), cols + 2);
+        memcpy(cell(block, rows + 1, 0), cell(block, 1, 0), cols + 2);
+        update_cells(block, next, 1, rows, 1, cols);
+        block.cells.swap(next.cells);
+    }
+    return MPI_Wtime() - start;
+}
+
+int main(int argc, char **argv) {
+    MPI_Init(&argc, &argv);
+
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    int board_size = DEFAULT_SIZE;
+    int local_size = 0;
+    int iterations = ITERATIONS;
+    int density = 50;
+    int verify = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            board_size = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--local") == 0 && i + 1 < argc) {
+            local_size = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--density") == 0 && i + 1 < argc) {
+            density = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--verify") == 0) {
+            verify = 1;
+        } else {
+            if (rank == 0) {
+                fprintf(stderr, "Usage: %s [--size N | --local N] [--iterations N] [--density PERCENT] [--verify]\n", argv[0]);
+            }
+            MPI_Finalize();
+            return 1;
+        }
+    }
+
+    int dims[2] = { 0, 0 };
+    int periods[2] = { 1, 1 };
+    MPI_Dims_create(size, 2, dims);
+    MPI_Comm cart;
+    MPI_Cart_create(MPI_COMM_WORLD, 2, dims, periods, 1, &cart);
+    MPI_Comm_rank(cart, &rank);
+    int coords[2];
+    MPI_Cart_coords(cart, rank, 2, coords);
+
+    // --local N: слабая масштабируемость, каждому рангу блок N x N независимо от числа процессов
+    int weak = local_size > 0;
+    int global_rows = weak ? dims[0] * local_size : board_size;
+    int global_cols = weak ? dims[1] * local_size : board_size;
+    if (global_rows < dims[0] || global_cols < dims[1] || iterations < 0) {
+        if (rank == 0) fprintf(stderr, "Board is smaller than the process grid\n");
+        MPI_Finalize();
+        return 1;
+    }
+
+    uint64_t seed = (uint64_t)time(NULL);
+    MPI_Bcast(&seed, 1, MPI_UINT64_T, 0, cart);
+
+    Block grid, next_grid;
+    block_range(global_rows, dims[0], coords[0], &grid.row0, &grid.rows);
+    block_range(global_cols, dims[1], coords[1], &grid.col0, &grid.cols);
+    grid.cells.assign((size_t)(grid.rows + 2) * (grid.cols + 2), 0);
+    next_grid = grid;
+    for (int r = 1; r <= grid.rows; r++) {
+        for (int c = 1; c <= grid.cols; c++) {
+            *cell(grid, r, c) = initial_cell(seed, grid.row0 + r - 1, grid.col0 + c - 1, density);
+        }
+    }
+
+    Halo halo;
+    halo_create(&halo, cart, grid);
+    MPI_Request requests[2 * DIRECTIONS];
+
+    double compute_time = 0.0, comm_time = 0.0;
+    MPI_Barrier(cart);
+    double start_time = MPI_Wtime();
+
+    // Основной цикл: внутренние клетки считаются, пока призрачные клетки в пути
+    for (int iter = 0; iter < iterations; iter++) {
+        double t0 = MPI_Wtime();
+        halo_start(&halo, grid, requests);
+        double t1 = MPI_Wtime();
+        if (grid.rows > 2 && grid.cols > 2) {
+            update_cells(grid, next_grid, 2, grid.rows - 1, 2, grid.cols - 1);
+        }
+        double t2 = MPI_Wtime();
+        MPI_Waitall(2 * DIRECTIONS, requests, MPI_STATUSES_IGNORE);
+        double t3 = MPI_Wtime();
+        update_border(grid, next_grid);
+        double t4 = MPI_Wtime();
+        grid.cells.swap(next_grid.cells);
+
+        comm_time += (t1 - t0) + (t3 - t2);
+        compute_time += (t2 - t1) + (t4 - t3);
+    }
+
+    double par_time = MPI_Wtime() - start_time;
+    double max_time = 0.0;
+    MPI_Reduce(&par_time, &max_time, 1, MPI_DOUBLE, MPI_MAX, 0, cart);
+
+    std::vector<double> all_compute(size), all_comm(size);
+    MPI_Gather(&compute_time, 1, MPI_DOUBLE, all_compute.data(), 1, MPI_DOUBLE, 0, cart);
+    MPI_Gather(&comm_time, 1, MPI_DOUBLE, all_comm.data(), 1, MPI_DOUBLE, 0, cart);
+
+    if (rank == 0) {
+        printf("Process grid %dx%d, board %dx%d, %d iterations\n", dims[0], dims[1], global_rows, global_cols, iterations);
+        for (int p = 0; p < size; p++) {
+            int p_coords[2], p_row0, p_rows, p_col0, p_cols;
+            MPI_Cart_coords(cart, p, 2, p_coords);
+            block_range(global_rows, dims[0], p_coords[0], &p_row0, &p_rows);
+            block_range(global_cols, dims[1], p_coords[1], &p_col0, &p_cols);
+            printf("Rank %d (%d,%d) block %dx%d: compute %f s, communication %f s\n",
+                   p, p_coords[0], p_coords[1], p_rows, p_cols, all_compute[p], all_comm[p]);
+        }
+        double cells = (double)global_rows * global_cols * iterations;
+        printf("Parallel time (%d processes): %f seconds\n", size, max_time);
+        printf("Cell updates per second: %.3e (%.3e per process)\n", cells / max_time, cells / max_time / size);
+
+        if (weak) {
+            // Эталон слабой масштабируемости - тот же блок N x N на одном процессе без обмена
+            Block baseline;
+            baseline.rows = baseline.cols = local_size;
+            baseline.row0 = baseline.col0 = 0;
+            baseline.cells.assign((size_t)(local_size + 2) * (local_size + 2), 0);
+            for (int r = 1; r <= local_size; r++) {
+                for (int c = 1; c <= local_size; c++) {
+                    *cell(baseline, r, c) = initial_cell(seed, r - 1, c - 1, density);
+                }
+            }
+            double seq_time = run_block_sequential(baseline, iterations);
+            printf("Sequential time (1 process, %dx%d): %f seconds\n", local_size, local_size, seq_time);
+            printf("Weak scaling efficiency: %.2f\n", seq_time / max_time);
+        }
+    }
+
+    if (verify) {
+        // Сборка всего поля на ранге 0 только для проверки небольших досок
+        std::vector<char> local((size_t)grid.rows * grid.cols);
+        for (int r = 0; r < grid.rows; r++) {
+            memcpy(&local[(size_t)r * grid.cols], cell(grid, r + 1, 1), grid.cols);
+        }
+        std::vector<int> counts(size), displs(size);
+        int local_count = (int)local.size();
+        MPI_Gather(&local_count, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, cart);
+        std::vector<char> gathered;
+        if (rank == 0) {
+            for (int p = 1; p < size; p++) displs[p] = displs[p - 1] + counts[p - 1];
+            gathered.resize((size_t)global_rows * global_cols);
+        }
+        MPI_Gatherv(local.data(), local_count, MPI_CHAR, gathered.data(), counts.data(), displs.data(),
+                    MPI_CHAR, 0, cart);
+
+        if (rank == 0) {
+            std::vector<char> board((size_t)global_rows * global_cols);
+            for (int i = 0; i < global_rows; i++) {
+                for (int j = 0; j < global_cols; j++) {
+                    board[(size_t)i * global_cols + j] = initial_cell(seed, i, j, density);
+                }
+            }
+            double seq_time = run_sequential(board, global_rows, global_cols, iterations);
+            printf("Sequential time: %f seconds\n", seq_time);
+
+            int correct = 1;
+            for (int p = 0; p < size && correct; p++) {
+                int p_coords[2], p_row0, p_rows, p_col0, p_cols;
+                MPI_Cart_coords(cart, p, 2, p_coords);
+                block_range(global_rows, dims[0], p_coords[0], &p_row0, &p_rows);
+                block_range(global_cols, dims[1], p_coords[1], &p_col0, &p_cols);
+                for (int r = 0; r < p_rows && correct; r++) {
+                    correct = memcmp(&gathered[displs[p] + (size_t)r * p_cols],
+                                     &board[(size_t)(p_row0 + r) * global_cols + p_col0], p_cols) == 0;
+                }
+            }
+            printf("Results match: %s\n", correct ? "Yes" : "No");
+        }
+    }
+
+    halo_free(&halo);
+    MPI_Comm_free(&cart);
+    MPI_Finalize();
+    return 0;
+}
@@ -1,107 +1,1176 @@
 #include <iostream>
 #include <vector>
-#include <complex>
 #include <chrono>
+#include <string>
+#include <cstring>
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstdint>
+#include <filesystem>
+#include <sys/resource.h>
+#include <unistd.h>
 #include <opencv2/opencv.hpp>
 #include <mpi.h>
+#include <omp.h>
+#include "../common/image_stream.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define SIMD_KERNELS 1
+#else
+#define SIMD_KERNELS 0
+#endif
+
+// Скалярное и векторные ядра должны совпадать попиксельно, поэтому умножение и сложение не сливаются в FMA
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+#define DEFAULT_WIDTH 800
+#define DEFAULT_HEIGHT 600
+#define DEFAULT_MAX_ITER 1000
+#define DEFAULT_X_MIN -2.0
+#define DEFAULT_X_MAX 1.0
+#define DEFAULT_Y_MIN -1.5
+#define DEFAULT_Y_MAX 1.5
+#define BLOCK_ROWS 4
+#define PERIOD_CHECK 8
+#define TILE_SIZE 64
+#define TRACE_MIN_SIZE 8
+#define TRACE_NEWTON_STEPS 4
+#define TRACE_TASK_AREA 4096
+#define STREAM_ROWS 16
+#define PALETTE_SIZE 4096
+
+#define TAG_WORK 1
+#define TAG_RESULT 2
+
+// Область комплексной плоскости, размер кадра в пикселях и предел итераций
+struct Viewport {
+    int width;
+    int height;
+    int max_iter;
+    double x_min, x_max;
+    double y_min, y_max;
+};
+
+// Ядра считают строку пикселей; скалярное - эталон, векторные обязаны совпадать с ним попиксельно.
+// Если norms не nullptr, туда пишется |z|^2 в момент убегания - он нужен для плавной раскраски.
+typedef void (*RowKernel)(const Viewport& view, int y, int* row, float* norms);
 
-#define WIDTH 800
-#define HEIGHT 600
-#define MAX_ITER 1000
-#define X_MIN -2.0
-#define X_MAX 1.0
-#define Y_MIN -1.5
-#define Y_MAX 1.5
-
-int mandelbrot(double real, double imag) {
-    std::complex<double> c(real, imag);
-    std::complex<double> z(0, 0);
+inline double pixel_real(const Viewport& view, int x) {
+    return view.x_min + (view.x_max - view.x_min) * x / view.width;
+}
+
+inline double pixel_imag(const Viewport& view, int y) {
+    return view.y_min + (view.y_max - view.y_min) * y / view.height;
+}
+
+// Главная кардиоида и круг периода 2 целиком лежат в множестве
+inline bool in_main_cardioid_or_bulb(double real, double imag) {
+    double shifted = real - 0.25;
+    double imag2 = imag * imag;
+    double q = shifted * shifted + imag2;
+    if (q * (q + shifted) <= 0.25 * imag2) return true;
+    double bulb = real + 1.0;
+    return bulb * bulb + imag2 <= 0.0625;
+}
+
+// Точное повторение z означает периодическую орбиту, которая уже никогда не убежит.
+// Сохранённая точка обновляется на итерациях PERIOD_CHECK, 2 * PERIOD_CHECK, ... (метод Брента).
+int mandelbrot(double real, double imag, int max_iter, double* escape_norm = nullptr) {
+    if (in_main_cardioid_or_bulb(real, imag)) return max_iter;
+    double zr = 0.0, zi = 0.0;
+    double saved_r = 0.0, saved_i = 0.0;
+    int check = PERIOD_CHECK;
     int iter = 0;
-    while (std::norm(z) <= 4.0 && iter < MAX_ITER) {
-        z = z * z + c;
+    while (iter < max_iter) {
+        double zr2 = zr * zr;
+        double zi2 = zi * zi;
+        if (zr2 + zi2 > 4.0) {
+            if (escape_norm) *escape_norm = zr2 + zi2;
+            break;
+        }
+        zi = (zr + zr) * zi + imag;
+        zr = (zr2 - zi2) + real;
         iter++;
+        if (zr == saved_r && zi == saved_i) return max_iter;
+        if (iter == check) {
+            saved_r = zr;
+            saved_i = zi;
+            check *= 2;
+        }
     }
     return iter;
 }
 
-void compute_mandelbrot_sequential(std::vector<int>& buffer) {
-    for (int y = 0; y < HEIGHT; y++) {
-        for (int x = 0; x < WIDTH; x++) {
-            double real = X_MIN + (X_MAX - X_MIN) * x / WIDTH;
-            double imag = Y_MIN + (Y_MAX - Y_MIN) * y / HEIGHT;
-            buffer[y * WIDTH + x] = mandelbrot(real, imag);
+void mandelbrot_row_scalar(const Viewport& view, int y, int* row, float* norms) {
+    double imag = pixel_imag(view, y);
+    for (int x = 0; x < view.width; x++) {
+        double norm = 0.0;
+        row[x] = mandelbrot(pixel_real(view, x), imag, view.max_iter, norms ? &norm : nullptr);
+        if (norms) norms[x] = (float)norm;
+    }
+}
+
+#if SIMD_KERNELS
+// 4 пикселя за раз; убежавшие дорожки выключаются маской, цикл идёт, пока активна хоть одна
+template <bool Norms>
+__attribute__((target("avx2")))
+void mandelbrot_row_avx2_impl(const Viewport& view, int y, int* row, float* norms) {
+    const __m256d four = _mm256_set1_pd(4.0);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d zero = _mm256_setzero_pd();
+    double imag = pixel_imag(view, y);
+    __m256d ci = _mm256_set1_pd(imag);
+    int x = 0;
+    for (; x + 4 <= view.width; x += 4) {
+        double lanes_r[4], interior[4];
+        for (int l = 0; l < 4; l++) {
+            lanes_r[l] = pixel_real(view, x + l);
+            interior[l] = in_main_cardioid_or_bulb(lanes_r[l], imag) ? 1.0 : 0.0;
         }
+        __m256d cr = _mm256_loadu_pd(lanes_r);
+        __m256d zr = zero, zi = zero;
+        __m256d saved_r = zero, saved_i = zero;
+        __m256d iters = zero;
+        __m256d escape_norm = zero;
+        __m256d in_set = _mm256_cmp_pd(_mm256_loadu_pd(interior), zero, _CMP_NEQ_OQ);
+        __m256d active = _mm256_cmp_pd(_mm256_loadu_pd(interior), zero, _CMP_EQ_OQ);
+
+        int check = PERIOD_CHECK;
+        for (int iter = 1; iter <= view.max_iter; iter++) {
+            __m256d zr2 = _mm256_mul_pd(zr, zr);
+            __m256d zi2 = _mm256_mul_pd(zi, zi);
+            __m256d norm = _mm256_add_pd(zr2, zi2);
+            __m256d inside = _mm256_cmp_pd(norm, four, _CMP_LE_OQ);
+            if (Norms) escape_norm = _mm256_blendv_pd(escape_norm, norm, _mm256_andnot_pd(inside, active));
+            active = _mm256_and_pd(active, inside);
+            if (_mm256_movemask_pd(active) == 0) break;
+            zi = _mm256_add_pd(_mm256_mul_pd(_mm256_add_pd(zr, zr), zi), ci);
+            zr = _mm256_add_pd(_mm256_sub_pd(zr2, zi2), cr);
+            iters = _mm256_add_pd(iters, _mm256_and_pd(active, one));
+
+            __m256d periodic = _mm256_and_pd(active, _mm256_and_pd(_mm256_cmp_pd(zr, saved_r, _CMP_EQ_OQ),
+                                                                    _mm256_cmp_pd(zi, saved_i, _CMP_EQ_OQ)));
+            in_set = _mm256_or_pd(in_set, periodic);
+            active = _mm256_andnot_pd(periodic, active);
+            if (iter == check) {
+                saved_r = zr;
+                saved_i = zi;
+                check *= 2;
+            }
+        }
+
+        iters = _mm256_blendv_pd(iters, _mm256_set1_pd(view.max_iter), in_set);
+        _mm_storeu_si128((__m128i*)&row[x], _mm256_cvtpd_epi32(iters));
+        if (Norms) _mm_storeu_ps(&norms[x], _mm256_cvtpd_ps(escape_norm));
+    }
+    for (; x < view.width; x++) {
+        double norm = 0.0;
+        row[x] = mandelbrot(pixel_real(view, x), imag, view.max_iter, &norm);
+        if (Norms) norms[x] = (float)norm;
+    }
+}
+
+__attribute__((target("avx2")))
+void mandelbrot_row_avx2(const Viewport& view, int y, int* row, float* norms) {
+    if (norms) {
+        mandelbrot_row_avx2_impl<true>(view, y, row, norms);
+    } else {
+        mandelbrot_row_avx2_impl<false>(view, y, row, norms);
     }
 }
 
-void buffer_to_image(const std::vector<int>& buffer, cv::Mat& image) {
-    for (int y = 0; y < HEIGHT; y++) {
-        for (int x = 0; x < WIDTH; x++) {
-            int iter = buffer[y * WIDTH + x];
-            int value = (iter == MAX_ITER) ? 0 : (255 * iter / MAX_ITER);
-            image.at<cv::Vec3b>(y, x) = cv::Vec3b(value, value, 255);
+// То же для 8 пикселей с масками AVX-512
+template <bool Norms>
+__attribute__((target("avx512f")))
+void mandelbrot_row_avx512_impl(const Viewport& view, int y, int* row, float* norms) {
+    const __m512d four = _mm512_set1_pd(4.0);
+    const __m512d one = _mm512_set1_pd(1.0);
+    __m512d ci = _mm512_set1_pd(pixel_imag(view, y));
+    double imag = pixel_imag(view, y);
+    int x = 0;
+    for (; x + 8 <= view.width; x += 8) {
+        double lanes_r[8];
+        __mmask8 in_set = 0;
+        for (int l = 0; l < 8; l++) {
+            lanes_r[l] = pixel_real(view, x + l);
+            if (in_main_cardioid_or_bulb(lanes_r[l], imag)) in_set |= (__mmask8)(1 << l);
+        }
+        __m512d cr = _mm512_loadu_pd(lanes_r);
+        __m512d zr = _mm512_setzero_pd(), zi = _mm512_setzero_pd();
+        __m512d saved_r = zr, saved_i = zi;
+        __m512d iters = _mm512_setzero_pd();
+        __m512d escape_norm = _mm512_setzero_pd();
+        __mmask8 active = (__mmask8)~in_set;
+
+        int check = PERIOD_CHECK;
+        for (int iter = 1; iter <= view.max_iter; iter++) {
+            __m512d zr2 = _mm512_mul_pd(zr, zr);
+            __m512d zi2 = _mm512_mul_pd(zi, zi);
+            __m512d norm = _mm512_add_pd(zr2, zi2);
+            __mmask8 inside = _mm512_cmp_pd_mask(norm, four, _CMP_LE_OQ);
+            if (Norms) escape_norm = _mm512_mask_mov_pd(escape_norm, active & (__mmask8)~inside, norm);
+            active &= inside;
+            if (active == 0) break;
+            zi = _mm512_add_pd(_mm512_mul_pd(_mm512_add_pd(zr, zr), zi), ci);
+            zr = _mm512_add_pd(_mm512_sub_pd(zr2, zi2), cr);
+            iters = _mm512_mask_add_pd(iters, active, iters, one);
+
+            __mmask8 periodic = active & _mm512_cmp_pd_mask(zr, saved_r, _CMP_EQ_OQ)
+                                       & _mm512_cmp_pd_mask(zi, saved_i, _CMP_EQ_OQ);
+            in_set |= periodic;
+            active &= (__mmask8)~periodic;
+            if (iter == check) {
+                saved_r = zr;
+                saved_i = zi;
+                check *= 2;
+            }
         }
+
+        iters = _mm512_mask_mov_pd(iters, in_set, _mm512_set1_pd(view.max_iter));
+        _mm256_storeu_si256((__m256i*)&row[x], _mm512_cvtpd_epi32(iters));
+        if (Norms) _mm256_storeu_ps(&norms[x], _mm512_cvtpd_ps(escape_norm));
+    }
+    for (; x < view.width; x++) {
+        double norm = 0.0;
+        row[x] = mandelbrot(pixel_real(view, x), imag, view.max_iter, &norm);
+        if (Norms) norms[x] = (float)norm;
     }
 }
 
-int main(int argc, char** argv) {
-    MPI_Init(&argc, &argv);
+__attribute__((target("avx512f")))
+void mandelbrot_row_avx512(const Viewport& view, int y, int* row, float* norms) {
+    if (norms) {
+        mandelbrot_row_avx512_impl<true>(view, y, row, norms);
+    } else {
+        mandelbrot_row_avx512_impl<false>(view, y, row, norms);
+    }
+}
+#endif
 
-    int rank, size;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &size);
+// Выбор ядра во время выполнения по возможностям процессора; requested - "auto" или имя ядра
+RowKernel select_kernel(const std::string& requested, std::string& name) {
+#if SIMD_KERNELS
+    __builtin_cpu_init();
+    bool has_avx512 = __builtin_cpu_supports("avx512f");
+    bool has_avx2 = __builtin_cpu_supports("avx2");
+    if ((requested == "auto" || requested == "avx512") && has_avx512) {
+        name = "avx512";
+        return mandelbrot_row_avx512;
+    }
+    if ((requested == "auto" || requested == "avx512" || requested == "avx2") && has_avx2) {
+        name = "avx2";
+        return mandelbrot_row_avx2;
+    }
+#else
+    (void)requested;
+#endif
+    name = "scalar";
+    return mandelbrot_row_scalar;
+}
 
-    cv::Mat image(HEIGHT, WIDTH, CV_8UC3, cv::Scalar(0, 0, 0));
-    std::vector<int> buffer(HEIGHT * WIDTH, 0);
+RowKernel row_kernel = mandelbrot_row_scalar;
 
-    double seq_time = 0.0;
-    if (rank == 0) {
-        auto start = std::chrono::high_resolution_clock::now();
-        compute_mandelbrot_sequential(buffer);
-        auto end = std::chrono::high_resolution_clock::now();
-        seq_time = std::chrono::duration<double>(end - start).count();
-        std::cout << "Sequential time: " << seq_time << " seconds\n";
+// Размер OpenMP-команды внутри ранга: 1 - чистый MPI (ранг на ядро), больше - гибридный режим (ранг на узел или сокет)
+int rank_threads = 1;
+
+void compute_row(const Viewport& view, int y, int* row) {
+    row_kernel(view, y, row, nullptr);
+}
+
+void compute_mandelbrot_sequential(const Viewport& view, std::vector<int>& buffer) {
+    for (int y = 0; y < view.height; y++) {
+        mandelbrot_row_scalar(view, y, &buffer[(size_t)y * view.width], nullptr);
     }
+}
 
-    auto start = std::chrono::high_resolution_clock::now();
+// Цвет по числу итераций берётся из таблицы; строки изображения заполняются через указатели параллельно
+void buffer_to_image(const Viewport& view, const std::vector<int>& buffer, cv::Mat& image, int threads) {
+    std::vector<cv::Vec3b> lut(view.max_iter + 1);
+    for (int iter = 0; iter <= view.max_iter; iter++) {
+        int value = (iter == view.max_iter) ? 0 : (255 * iter / view.max_iter);
+        lut[iter] = cv::Vec3b(value, value, 255);
+    }
+    #pragma omp parallel for schedule(static) num_threads(threads)
+    for (int y = 0; y < view.height; y++) {
+        const int* in = &buffer[(size_t)y * view.width];
+        cv::Vec3b* out = image.ptr<cv::Vec3b>(y);
+        for (int x = 0; x < view.width; x++) {
+            out[x] = lut[in[x]];
+        }
+    }
+}
 
-    int rows_per_process = HEIGHT / size;
-    int start_row = rank * rows_per_process;
-    int end_row = (rank == size - 1) ? HEIGHT : start_row + rows_per_process;
+// Палитра плавной раскраски в RGB: та же шкала, что в buffer_to_image, но с PALETTE_SIZE оттенками
+std::vector<unsigned char> build_palette() {
+    std::vector<unsigned char> palette(3 * PALETTE_SIZE);
+    for (int i = 0; i < PALETTE_SIZE; i++) {
+        unsigned char value = (unsigned char)(255 * i / (PALETTE_SIZE - 1));
+        palette[3 * i] = 255;
+        palette[3 * i + 1] = value;
+        palette[3 * i + 2] = value;
+    }
+    return palette;
+}
+
+// Дробное число итераций nu = iter + 1 - log2(log|z|) убирает ступени между соседними iter
+void colorize_rows(const Viewport& view, const int* iters, const float* norms, int rows,
+                   const std::vector<unsigned char>& palette, unsigned char* rgb, int threads) {
+    #pragma omp parallel for schedule(static) num_threads(threads)
+    for (int r = 0; r < rows; r++) {
+        const int* in = iters + (size_t)r * view.width;
+        const float* norm = norms + (size_t)r * view.width;
+        unsigned char* out = rgb + (size_t)r * view.width * 3;
+        for (int x = 0; x < view.width; x++) {
+            int index = 0;
+            if (in[x] < view.max_iter) {
+                double nu = in[x] + 1.0 - std::log2(0.5 * std::log((double)norm[x]));
+                double t = std::min(std::max(nu / view.max_iter, 0.0), 1.0);
+                index = (int)(t * (PALETTE_SIZE - 1));
+            }
+            std::memcpy(out + 3 * x, &palette[3 * index], 3);
+        }
+    }
+}
+
+// Трассировка границ (Мариани - Сильвер): если вся рамка прямоугольника лежит внутри множества и это доказано,
+// внутренность заполняется без вычисления, иначе прямоугольник делится на четыре, а малый считается попиксельно.
+// Заливка обязана совпадать с попиксельным расчётом.
+bool boundary_tracing = false;
+long long skipped_pixels = 0;
+
+inline int compute_pixel(const Viewport& view, int x, int y) {
+    return mandelbrot(pixel_real(view, x), pixel_imag(view, y), view.max_iter);
+}
 
-    std::vector<int> local_buffer((end_row - start_row) * WIDTH, 0);
+// Радиус круга вокруг c, целиком лежащего внутри множества, или 0, если это не удалось доказать.
+// Притягивающий цикл периода p уточняется методом Ньютона, по производным f^p в нём считается оценка
+// внутреннего расстояния d; по теореме Кёбе круг радиуса d / 4 не содержит точек границы
+double interior_radius(double real, double imag, int max_iter) {
+    typedef std::complex<double> complex;
+    // Орбита сходится к циклу, когда z возвращается к сохранённой точке (метод Брента, как в mandelbrot).
+    // Эти циклы самые длинные, поэтому они на double: умножение std::complex без -ffast-math - вызов библиотеки
+    double zr = 0.0, zi = 0.0, saved_r = 0.0, saved_i = 0.0;
+    const double tolerance = 1e-18;
+    int check = PERIOD_CHECK;
+    bool converged = false;
+    for (int iter = 1; iter <= max_iter && !converged; iter++) {
+        double zr2 = zr * zr, zi2 = zi * zi;
+        if (zr2 + zi2 > 4.0) return 0.0;
+        zi = (zr + zr) * zi + imag;
+        zr = (zr2 - zi2) + real;
+        double er = zr - saved_r, ei = zi - saved_i;
+        converged = er * er + ei * ei < tolerance;
+        if (iter == check) {
+            saved_r = zr;
+            saved_i = zi;
+            check *= 2;
+        }
+    }
+    if (!converged) return 0.0;
+    // Период - первое возвращение орбиты к z; ошибку допуска исправит Ньютон и проверка множителя ниже
+    double start_r = zr, start_i = zi;
+    int period = 0;
+    for (int p = 1; p <= max_iter && period == 0; p++) {
+        double zr2 = zr * zr, zi2 = zi * zi;
+        zi = (zr + zr) * zi + imag;
+        zr = (zr2 - zi2) + real;
+        double er = zr - start_r, ei = zi - start_i;
+        if (er * er + ei * ei < 1e6 * tolerance) period = p;
+    }
+    if (period == 0) return 0.0;
+    complex c(real, imag), z(start_r, start_i);
+    for (int step = 0; step < TRACE_NEWTON_STEPS; step++) {
+        complex w = z, dw = 1.0;
+        for (int p = 0; p < period; p++) {
+            dw = 2.0 * w * dw;
+            w = w * w + c;
+        }
+        if (dw == 1.0) return 0.0;
+        z -= (w - z) / (dw - 1.0);
+    }
+    // dz, dc - производные f^p по z и по c, dzz и dcz - вторые
+    complex w = z, dz = 1.0, dc = 0.0, dzz = 0.0, dcz = 0.0;
+    for (int p = 0; p < period; p++) {
+        dcz = 2.0 * (dz * dc + w * dcz);
+        dzz = 2.0 * (dz * dz + w * dzz);
+        dz = 2.0 * w * dz;
+        dc = 2.0 * w * dc + 1.0;
+        w = w * w + c;
+    }
+    double multiplier = std::norm(dz);
+    if (!(multiplier < 1.0) || std::norm(w - z) > tolerance) return 0.0;
+    double estimate = (1.0 - multiplier) / std::abs(dcz + dzz * dc / (1.0 - dz));
+    return std::isfinite(estimate) ? 0.25 * estimate : 0.0;
+}
+
+// data - строки кадра начиная с row0; границы прямоугольника включительные и уже посчитаны.
+// Возвращает число пикселей, заполненных без вычисления.
+long long trace_rect(const Viewport& view, int* data, int row0, int x0, int y0, int x1, int y1) {
+    if (x1 - x0 < 2 || y1 - y0 < 2) return 0;
+    auto at = [&](int x, int y) -> int& { return data[(size_t)(y - row0) * view.width + x]; };
+
+    int value = at(x0, y0);
+    bool uniform = true;
+    for (int x = x0; x <= x1 && uniform; x++) uniform = at(x, y0) == value && at(x, y1) == value;
+    for (int y = y0; y <= y1 && uniform; y++) uniform = at(x0, y) == value && at(x1, y) == value;
+    // Полосу с одним числом итераций ниже max_iter доказать нечем: узкий выступ соседней полосы может
+    // пройти между пикселями рамки, поэтому такие прямоугольники только делятся
+    uniform = uniform && value == view.max_iter;
+    if (uniform) {
+        // Внутренность множества заливается, только если она доказана: круг вокруг центра прямоугольника,
+        // где нет границы множества, должен накрыть весь прямоугольник. Иначе тонкая нить снаружи множества
+        // может пройти между пикселями рамки
+        double dx = (view.x_max - view.x_min) / view.width, dy = (view.y_max - view.y_min) / view.height;
+        double center_r = view.x_min + dx * 0.5 * (x0 + x1), center_i = view.y_min + dy * 0.5 * (y0 + y1);
+        double half_diagonal = 0.5 * std::hypot(dx * (x1 - x0), dy * (y1 - y0));
+        uniform = interior_radius(center_r, center_i, view.max_iter) > half_diagonal;
+    }
+    if (uniform) {
+        for (int y = y0 + 1; y < y1; y++) {
+            std::fill(&at(x0 + 1, y), &at(x1, y), value);
+        }
+        return (long long)(x1 - x0 - 1) * (y1 - y0 - 1);
+    }
 
-    for (int y = start_row; y < end_row; y++) {
-        for (int x = 0; x < WIDTH; x++) {
-            double real = X_MIN + (X_MAX - X_MIN) * x / WIDTH;
-            double imag = Y_MIN + (Y_MAX - Y_MIN) * y / HEIGHT;
-            local_buffer[(y - start_row) * WIDTH + x] = mandelbrot(real, imag);
+    if (x1 - x0 <= TRACE_MIN_SIZE || y1 - y0 <= TRACE_MIN_SIZE) {
+        for (int y = y0 + 1; y < y1; y++) {
+            for (int x = x0 + 1; x < x1; x++) at(x, y) = compute_pixel(view, x, y);
         }
+        return 0;
+    }
+
+    int xm = (x0 + x1) / 2, ym = (y0 + y1) / 2;
+    for (int x = x0 + 1; x < x1; x++) at(x, ym) = compute_pixel(view, x, ym);
+    for (int y = y0 + 1; y < y1; y++) {
+        if (y != ym) at(xm, y) = compute_pixel(view, xm, y);
+    }
+
+    // Четыре части пишут только свою внутренность, общие линии уже посчитаны
+    long long skipped[4];
+    bool spawn = (long long)(x1 - x0) * (y1 - y0) >= TRACE_TASK_AREA;
+    #pragma omp task shared(skipped) if (spawn)
+    skipped[0] = trace_rect(view, data, row0, x0, y0, xm, ym);
+    #pragma omp task shared(skipped) if (spawn)
+    skipped[1] = trace_rect(view, data, row0, xm, y0, x1, ym);
+    #pragma omp task shared(skipped) if (spawn)
+    skipped[2] = trace_rect(view, data, row0, x0, ym, xm, y1);
+    #pragma omp task shared(skipped) if (spawn)
+    skipped[3] = trace_rect(view, data, row0, xm, ym, x1, y1);
+    #pragma omp taskwait
+    return skipped[0] + skipped[1] + skipped[2] + skipped[3];
+}
+
+// Строки [y0, y1] кадра с трассировкой границ; рекурсия выполняется задачами OpenMP
+long long render_rect_traced(const Viewport& view, int* data, int row0, int y0, int y1) {
+    int x1 = view.width - 1;
+    for (int x = 0; x <= x1; x++) {
+        data[(size_t)(y0 - row0) * view.width + x] = compute_pixel(view, x, y0);
+        data[(size_t)(y1 - row0) * view.width + x] = compute_pixel(view, x, y1);
+    }
+    for (int y = y0 + 1; y < y1; y++) {
+        data[(size_t)(y - row0) * view.width] = compute_pixel(view, 0, y);
+        data[(size_t)(y - row0) * view.width + x1] = compute_pixel(view, x1, y);
     }
 
+    long long skipped = 0;
+    #pragma omp parallel num_threads(rank_threads)
+    #pragma omp single
+    skipped = trace_rect(view, data, row0, 0, y0, x1, y1);
+    return skipped;
+}
+
+double seconds_since(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// Статическое разбиение: каждому рангу одна сплошная полоса строк
+void render_static(const Viewport& view, int rank, int size, std::vector<int>& buffer, double& busy) {
+    int rows_per_process = view.height / size;
+    int start_row = rank * rows_per_process;
+    int end_row = (rank == size - 1) ? view.height : start_row + rows_per_process;
+
+    std::vector<int> local_buffer((end_row - start_row) * view.width, 0);
+    auto start = std::chrono::high_resolution_clock::now();
+    if (boundary_tracing) {
+        if (end_row > start_row) {
+            skipped_pixels += render_rect_traced(view, local_buffer.data(), start_row, start_row, end_row - 1);
+        }
+    } else {
+        #pragma omp parallel for schedule(dynamic) num_threads(rank_threads)
+        for (int y = start_row; y < end_row; y++) {
+            compute_row(view, y, &local_buffer[(y - start_row) * view.width]);
+        }
+    }
+    busy = seconds_since(start);
+
     std::vector<int> recv_counts(size);
     std::vector<int> displs(size);
     for (int i = 0; i < size; i++) {
-        int rows = (i == size - 1) ? (HEIGHT - i * rows_per_process) : rows_per_process;
-        recv_counts[i] = rows * WIDTH;
-        displs[i] = i * rows_per_process * WIDTH;
+        int rows = (i == size - 1) ? (view.height - i * rows_per_process) : rows_per_process;
+        recv_counts[i] = rows * view.width;
+        displs[i] = i * rows_per_process * view.width;
     }
 
     MPI_Gatherv(local_buffer.data(), local_buffer.size(), MPI_INT,
                 buffer.data(), recv_counts.data(), displs.data(), MPI_INT,
                 0, MPI_COMM_WORLD);
+}
+
+// Циклическое разбиение: ранг r считает строки r, r + size, ...; ранг 0 принимает их неблокирующе
+void render_cyclic(const Viewport& view, int rank, int size, std::vector<int>& buffer, double& busy) {
+    int local_rows = (view.height - rank + size - 1) / size;
+    std::vector<int> local_buffer(local_rows * view.width, 0);
+
+    std::vector<std::vector<int>> staging;
+    std::vector<MPI_Request> requests;
+    if (rank == 0) {
+        staging.resize(size);
+        requests.resize(size - 1);
+        for (int p = 1; p < size; p++) {
+            staging[p].resize(((view.height - p + size - 1) / size) * view.width);
+            MPI_Irecv(staging[p].data(), staging[p].size(), MPI_INT, p, TAG_RESULT, MPI_COMM_WORLD, &requests[p - 1]);
+        }
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    #pragma omp parallel for schedule(dynamic) num_threads(rank_threads)
+    for (int k = 0; k < local_rows; k++) {
+        compute_row(view, rank + k * size, &local_buffer[k * view.width]);
+    }
+    busy = seconds_since(start);
+
+    if (rank != 0) {
+        MPI_Send(local_buffer.data(), local_buffer.size(), MPI_INT, 0, TAG_RESULT, MPI_COMM_WORLD);
+        return;
+    }
+
+    staging[0].swap(local_buffer);
+    auto unpack = [&](int p) {
+        for (int k = 0; p + k * size < view.height; k++) {
+            std::memcpy(&buffer[(p + k * size) * view.width], &staging[p][k * view.width], view.width * sizeof(int));
+        }
+    };
+    unpack(0);
+    for (int done = 0; done < size - 1; done++) {
+        int index;
+        MPI_Waitany(size - 1, requests.data(), &index, MPI_STATUS_IGNORE);
+        unpack(index + 1);
+    }
+}
+
+// Динамическое распределение: ранг 0 раздаёт блоки по BLOCK_ROWS строк на поток по мере готовности рабочих,
+// чтобы каждый блок занимал всю команду OpenMP ранга.
+// Ответ рабочего - номер первой строки блока и сами строки; он же служит запросом следующего блока.
+void render_dynamic(const Viewport& view, int rank, int size, std::vector<int>& buffer, double& busy) {
+    busy = 0.0;
+    if (size == 1) {
+        auto start = std::chrono::high_resolution_clock::now();
+        #pragma omp parallel for schedule(dynamic) num_threads(rank_threads)
+        for (int y = 0; y < view.height; y++) {
+            compute_row(view, y, &buffer[y * view.width]);
+        }
+        busy = seconds_since(start);
+        return;
+    }
+
+    const int block_rows = BLOCK_ROWS * rank_threads;
+    const int message_size = 1 + block_rows * view.width;
+
+    if (rank == 0) {
+        int workers = size - 1;
+        int next_row = 0;
+        std::vector<std::vector<int>> results(workers, std::vector<int>(message_size));
+        std::vector<MPI_Request> requests(workers, MPI_REQUEST_NULL);
+
+        for (int w = 0; w < workers; w++) {
+            int start_row = (next_row < view.height) ? next_row : -1;
+            if (start_row >= 0) next_row += block_rows;
+            MPI_Send(&start_row, 1, MPI_INT, w + 1, TAG_WORK, MPI_COMM_WORLD);
+            if (start_row >= 0) {
+                MPI_Irecv(results[w].data(), message_size, MPI_INT, w + 1, TAG_RESULT, MPI_COMM_WORLD, &requests[w]);
+            }
+        }
+
+        for (;;) {
+            int w;
+            MPI_Waitany(workers, requests.data(), &w, MPI_STATUS_IGNORE);
+            if (w == MPI_UNDEFINED) break;
+
+            int start_row = results[w][0];
+            int rows = std::min(block_rows, view.height - start_row);
+            std::memcpy(&buffer[start_row * view.width], &results[w][1], rows * view.width * sizeof(int));
+
+            int assigned = (next_row < view.height) ? next_row : -1;
+            if (assigned >= 0) next_row += block_rows;
+            MPI_Send(&assigned, 1, MPI_INT, w + 1, TAG_WORK, MPI_COMM_WORLD);
+            if (assigned >= 0) {
+                MPI_Irecv(results[w].data(), message_size, MPI_INT, w + 1, TAG_RESULT, MPI_COMM_WORLD, &requests[w]);
+            }
+        }
+        return;
+    }
+
+    std::vector<int> block(message_size);
+    for (;;) {
+        int start_row;
+        MPI_Recv(&start_row, 1, MPI_INT, 0, TAG_WORK, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        if (start_row < 0) break;
+
+        int rows = std::min(block_rows, view.height - start_row);
+        auto start = std::chrono::high_resolution_clock::now();
+        block[0] = start_row;
+        #pragma omp parallel for schedule(dynamic) num_threads(rank_threads)
+        for (int r = 0; r < rows; r++) {
+            compute_row(view, start_row + r, &block[1 + r * view.width]);
+        }
+        busy += seconds_since(start);
+        MPI_Send(block.data(), 1 + rows * view.width, MPI_INT, 0, TAG_RESULT, MPI_COMM_WORLD);
+    }
+}
+
+// Тайловый режим: кадр задаётся центром и уровнем масштаба, пиксели лежат на общей для всех кадров
+// сетке с шагом base_step / 2^zoom. Тайл TILE_SIZE x TILE_SIZE с ключом (zoom, tx, ty, max_iter)
+// хранится в кэше на диске как сырые счётчики итераций, поэтому соседние и повторные кадры
+// пересчитывают только недостающие тайлы.
+struct TileView {
+    double center_x, center_y;
+    int zoom;
+    double base_step;
+};
+
+struct TileHeader {
+    char magic[4];
+    int32_t size;
+    int32_t max_iter;
+    double compute_seconds;
+};
+
+struct CacheStats {
+    long long tiles = 0;
+    long long hits = 0;
+    double saved_seconds = 0.0;
+    double compute_seconds = 0.0;
+    double io_seconds = 0.0;
+};
+
+inline double tile_step(const TileView& tiles) {
+    return std::ldexp(tiles.base_step, -tiles.zoom);
+}
+
+// Глобальный индекс левого верхнего пикселя кадра
+inline int64_t frame_origin(double center, double step, int pixels) {
+    return (int64_t)std::floor(center / step) - pixels / 2;
+}
+
+inline int64_t floor_div(int64_t a, int64_t b) {
+    return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+Viewport tile_viewport(const TileView& tiles, int64_t tx, int64_t ty, int max_iter) {
+    double span = tile_step(tiles) * TILE_SIZE;
+    Viewport tile;
+    tile.width = tile.height = TILE_SIZE;
+    tile.max_iter = max_iter;
+    tile.x_min = tx * span;
+    tile.x_max = (tx + 1) * span;
+    tile.y_min = ty * span;
+    tile.y_max = (ty + 1) * span;
+    return tile;
+}
+
+// Метод расчёта входит в ключ: числа итераций у тайлов одинаковы, но в заголовке хранится время расчёта своим методом
+std::string tile_path(const std::string& dir, int zoom, int64_t tx, int64_t ty, int max_iter, bool trace) {
+    return dir + "/z" + std::to_string(zoom) + "_x" + std::to_string(tx) + "_y" + std::to_string(ty)
+         + "_i" + std::to_string(max_iter) + (trace ? "_trace" : "_brute") + ".tile";
+}
+
+bool load_tile(const std::string& path, int max_iter, int* counts, double& compute_seconds) {
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) return false;
+    TileHeader header;
+    bool ok = std::fread(&header, sizeof(header), 1, file) == 1
+           && std::memcmp(header.magic, "MBT1", 4) == 0
+           && header.size == TILE_SIZE && header.max_iter == max_iter
+           && std::fread(counts, sizeof(int32_t), TILE_SIZE * TILE_SIZE, file) == TILE_SIZE * TILE_SIZE;
+    std::fclose(file);
+    if (ok) compute_seconds = header.compute_seconds;
+    return ok;
+}
+
+// Запись во временный файл и переименование, чтобы параллельный запуск не прочитал недописанный тайл.
+// Уникальное имя выдаёт mkstemp: тайлы пишут сразу несколько потоков и рангов
+void store_tile(const std::string& path, int max_iter, const int* counts, double compute_seconds) {
+    std::string temp = path + ".tmpXXXXXX";
+    int fd = mkstemp(&temp[0]);
+    if (fd < 0) return;
+    FILE* file = fdopen(fd, "wb");
+    if (!file) {
+        ::close(fd);
+        std::remove(temp.c_str());
+        return;
+    }
+    TileHeader header = { { 'M', 'B', 'T', '1' }, TILE_SIZE, max_iter, compute_seconds };
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1
+           && std::fwrite(counts, sizeof(int32_t), TILE_SIZE * TILE_SIZE, file) == TILE_SIZE * TILE_SIZE;
+    ok = (std::fclose(file) == 0) && ok;
+    if (!ok || std::rename(temp.c_str(), path.c_str()) != 0) {
+        std::remove(temp.c_str());
+    }
+}
+
+void compute_tile(const Viewport& tile, int* counts, RowKernel kernel, bool trace) {
+    if (trace) {
+        long long skipped = render_rect_traced(tile, counts, 0, 0, TILE_SIZE - 1);
+        #pragma omp atomic
+        skipped_pixels += skipped;
+        return;
+    }
+    for (int y = 0; y < TILE_SIZE; y++) {
+        kernel(tile, y, &counts[y * TILE_SIZE], nullptr);
+    }
+}
+
+// Какие тайлы глобальной сетки покрывают кадр
+struct TileFrame {
+    int64_t gx0, gy0;
+    int64_t tx0, ty0;
+    int tiles_x;
+    int total;
+};
+
+TileFrame tile_frame(const Viewport& view, const TileView& tiles) {
+    double step = tile_step(tiles);
+    TileFrame frame;
+    frame.gx0 = frame_origin(tiles.center_x, step, view.width);
+    frame.gy0 = frame_origin(tiles.center_y, step, view.height);
+    frame.tx0 = floor_div(frame.gx0, TILE_SIZE);
+    frame.ty0 = floor_div(frame.gy0, TILE_SIZE);
+    frame.tiles_x = (int)(floor_div(frame.gx0 + view.width - 1, TILE_SIZE) - frame.tx0 + 1);
+    frame.total = frame.tiles_x * (int)(floor_div(frame.gy0 + view.height - 1, TILE_SIZE) - frame.ty0 + 1);
+    return frame;
+}
+
+// Тайлы first, first + stride, ... дописываются в local и считаются командой из threads потоков; пустой cache_dir - без кэша
+void process_tiles(const Viewport& view, const TileView& tiles, const TileFrame& frame, const std::string& cache_dir,
+                   RowKernel kernel, bool trace, int first, int stride, int threads,
+                   std::vector<int>& local, CacheStats& stats) {
+    int count = (frame.total - first + stride - 1) / stride;
+    if (count <= 0) return;
+    size_t base = local.size();
+    local.resize(base + (size_t)count * TILE_SIZE * TILE_SIZE);
+
+    long long hits = 0;
+    double saved_seconds = 0.0, compute_seconds = 0.0, io_seconds = 0.0;
+    #pragma omp parallel for schedule(dynamic) num_threads(threads) \
+        reduction(+:hits, saved_seconds, compute_seconds, io_seconds)
+    for (int i = 0; i < count; i++) {
+        int t = first + i * stride;
+        int64_t tx = frame.tx0 + t % frame.tiles_x, ty = frame.ty0 + t / frame.tiles_x;
+        int* counts = &local[base + (size_t)i * TILE_SIZE * TILE_SIZE];
+
+        auto start = std::chrono::high_resolution_clock::now();
+        std::string path = cache_dir.empty() ? "" : tile_path(cache_dir, tiles.zoom, tx, ty, view.max_iter, trace);
+        double stored_seconds = 0.0;
+        if (!path.empty() && load_tile(path, view.max_iter, counts, stored_seconds)) {
+            hits++;
+            saved_seconds += stored_seconds;
+            io_seconds += seconds_since(start);
+        } else {
+            compute_tile(tile_viewport(tiles, tx, ty, view.max_iter), counts, kernel, trace);
+            double elapsed = seconds_since(start);
+            compute_seconds += elapsed;
+            if (!path.empty()) {
+                auto io_start = std::chrono::high_resolution_clock::now();
+                store_tile(path, view.max_iter, counts, elapsed);
+                io_seconds += seconds_since(io_start);
+            }
+        }
+    }
+    stats.tiles += count;
+    stats.hits += hits;
+    stats.saved_seconds += saved_seconds;
+    stats.compute_seconds += compute_seconds;
+    stats.io_seconds += io_seconds;
+}
+
+// Вырезание кадра из тайлов: тайл t лежит в части stride-го участника t % stride под номером t / stride
+void assemble_tiles(const Viewport& view, const TileFrame& frame, const std::vector<int>& data,
+                    const std::vector<int>& displs, int stride, std::vector<int>& buffer) {
+    for (int t = 0; t < frame.total; t++) {
+        int64_t tx = frame.tx0 + t % frame.tiles_x, ty = frame.ty0 + t / frame.tiles_x;
+        const int* tile = &data[displs[t % stride] + (size_t)(t / stride) * TILE_SIZE * TILE_SIZE];
+        for (int ly = 0; ly < TILE_SIZE; ly++) {
+            int64_t y = ty * TILE_SIZE + ly - frame.gy0;
+            if (y < 0 || y >= view.height) continue;
+            for (int lx = 0; lx < TILE_SIZE; lx++) {
+                int64_t x = tx * TILE_SIZE + lx - frame.gx0;
+                if (x < 0 || x >= view.width) continue;
+                buffer[(size_t)y * view.width + x] = tile[ly * TILE_SIZE + lx];
+            }
+        }
+    }
+}
+
+// Тайлы кадра распределяются по рангам циклически и собираются на ранге 0
+void render_tiled(const Viewport& view, const TileView& tiles, const std::string& cache_dir,
+                  int rank, int size, std::vector<int>& buffer, CacheStats& stats, double& busy) {
+    TileFrame frame = tile_frame(view, tiles);
+    std::vector<int> local;
+    auto start = std::chrono::high_resolution_clock::now();
+    process_tiles(view, tiles, frame, cache_dir, row_kernel, boundary_tracing, rank, size, rank_threads, local, stats);
+    busy = seconds_since(start);
+
+    std::vector<int> counts(size), displs(size);
+    int local_count = (int)local.size();
+    MPI_Gather(&local_count, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, MPI_COMM_WORLD);
+    std::vector<int> gathered;
+    if (rank == 0) {
+        for (int p = 1; p < size; p++) displs[p] = displs[p - 1] + counts[p - 1];
+        gathered.resize(displs[size - 1] + counts[size - 1]);
+    }
+    MPI_Gatherv(local.data(), local_count, MPI_INT, gathered.data(), counts.data(), displs.data(), MPI_INT,
+                0, MPI_COMM_WORLD);
+    if (rank == 0) {
+        assemble_tiles(view, frame, gathered, displs, size, buffer);
+    }
+}
+
+// Безголовый режим: порции по STREAM_ROWS строк раздаются рангам циклически, раскрашиваются на месте
+// и сразу пишутся рангом 0 в файл по порядку. Кадр целиком не хранится ни на одном ранге.
+bool render_stream(const Viewport& view, int rank, int size, const std::string& path,
+                   double& busy, double& color_time, double& write_time) {
+    int chunks = (view.height + STREAM_ROWS - 1) / STREAM_ROWS;
+    size_t chunk_pixels = (size_t)STREAM_ROWS * view.width;
+    std::vector<int> iters(chunk_pixels);
+    std::vector<float> norms(chunk_pixels);
+    std::vector<unsigned char> rgb[2] = { std::vector<unsigned char>(3 * chunk_pixels),
+                                          std::vector<unsigned char>(3 * chunk_pixels) };
+    MPI_Request pending[2] = { MPI_REQUEST_NULL, MPI_REQUEST_NULL };
+    std::vector<unsigned char> palette = build_palette();
+
+    ImageStream stream;
+    int opened = (rank == 0) ? stream.open(path, view.width, view.height) : 1;
+    MPI_Bcast(&opened, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (!opened) return false;
+
+    busy = color_time = write_time = 0.0;
+    int local_chunk = 0;
+    for (int k = 0; k < chunks; k++) {
+        int owner = k % size;
+        int y0 = k * STREAM_ROWS;
+        int rows = std::min(STREAM_ROWS, view.height - y0);
+        int count = rows * view.width * 3;
+        if (owner == rank) {
+            // Буферы отправки чередуются: пока одна порция уходит, считается следующая
+            std::vector<unsigned char>& out = rgb[local_chunk % 2];
+            MPI_Wait(&pending[local_chunk % 2], MPI_STATUS_IGNORE);
+            auto start = std::chrono::high_resolution_clock::now();
+            #pragma omp parallel for schedule(dynamic) num_threads(rank_threads)
+            for (int r = 0; r < rows; r++) {
+                row_kernel(view, y0 + r, &iters[(size_t)r * view.width], &norms[(size_t)r * view.width]);
+            }
+            busy += seconds_since(start);
+            start = std::chrono::high_resolution_clock::now();
+            colorize_rows(view, iters.data(), norms.data(), rows, palette, out.data(), rank_threads);
+            color_time += seconds_since(start);
+            if (rank == 0) {
+                start = std::chrono::high_resolution_clock::now();
+                stream.write_rows(out.data(), rows);
+                write_time += seconds_since(start);
+            } else {
+                MPI_Isend(out.data(), count, MPI_UNSIGNED_CHAR, 0, TAG_RESULT, MPI_COMM_WORLD, &pending[local_chunk % 2]);
+            }
+            local_chunk++;
+        } else if (rank == 0) {
+            MPI_Recv(rgb[0].data(), count, MPI_UNSIGNED_CHAR, owner, TAG_RESULT, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            auto start = std::chrono::high_resolution_clock::now();
+            stream.write_rows(rgb[0].data(), rows);
+            write_time += seconds_since(start);
+        }
+    }
+    MPI_Waitall(2, pending, MPI_STATUSES_IGNORE);
+
+    int closed = 1;
+    if (rank == 0) {
+        auto start = std::chrono::high_resolution_clock::now();
+        closed = stream.close();
+        write_time += seconds_since(start);
+    }
+    MPI_Bcast(&closed, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    return closed;
+}
+
+// Пиковый резидентный объём процесса в мегабайтах (ru_maxrss в Linux - в килобайтах)
+double peak_memory_mb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0;
+}
+
+// Пиковая память каждого ранга собирается на ранге 0
+void report_memory(int rank, int size) {
+    double memory = peak_memory_mb();
+    std::vector<double> all_memory(size);
+    MPI_Gather(&memory, 1, MPI_DOUBLE, all_memory.data(), 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    if (rank != 0) return;
+    double total = 0.0;
+    for (int p = 0; p < size; p++) {
+        std::cout << "Rank " << p << ": peak memory " << all_memory[p] << " MB\n";
+        total += all_memory[p];
+    }
+    std::cout << "Peak memory over all ranks: " << total << " MB\n";
+}
+
+int main(int argc, char** argv) {
+    // Внутри ранга MPI вызывает только главный поток, OpenMP-команда лишь считает пиксели
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    if (provided < MPI_THREAD_FUNNELED && rank == 0) {
+        std::cerr << "Warning: MPI library does not provide MPI_THREAD_FUNNELED\n";
+    }
 
-    auto end = std::chrono::high_resolution_clock::now();
-    double par_time = std::chrono::duration<double>(end - start).count();
+    Viewport view = { DEFAULT_WIDTH, DEFAULT_HEIGHT, DEFAULT_MAX_ITER,
+                      DEFAULT_X_MIN, DEFAULT_X_MAX, DEFAULT_Y_MIN, DEFAULT_Y_MAX };
+    TileView tiles = { (DEFAULT_X_MIN + DEFAULT_X_MAX) / 2, (DEFAULT_Y_MIN + DEFAULT_Y_MAX) / 2, 0,
+                       (DEFAULT_X_MAX - DEFAULT_X_MIN) / DEFAULT_WIDTH };
+    std::string schedule = "static";
+    std::string kernel = "auto";
+    std::string cache_dir;
+    std::string output = "mandelbrot.png";
+    bool tiled = false;
+    bool headless = false;
+    bool valid = true;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--schedule" && has_value) {
+            schedule = argv[++i];
+        } else if (arg == "--kernel" && has_value) {
+            kernel = argv[++i];
+        } else if (arg == "--width" && has_value) {
+            view.width = std::atoi(argv[++i]);
+        } else if (arg == "--height" && has_value) {
+            view.height = std::atoi(argv[++i]);
+        } else if (arg == "--max-iter" && has_value) {
+            view.max_iter = std::atoi(argv[++i]);
+        } else if (arg == "--x-min" && has_value) {
+            view.x_min = std::atof(argv[++i]);
+        } else if (arg == "--x-max" && has_value) {
+            view.x_max = std::atof(argv[++i]);
+        } else if (arg == "--y-min" && has_value) {
+            view.y_min = std::atof(argv[++i]);
+        } else if (arg == "--y-max" && has_value) {
+            view.y_max = std::atof(argv[++i]);
+        } else if (arg == "--method" && has_value) {
+            std::string method = argv[++i];
+            if (method != "brute" && method != "trace") valid = false;
+            boundary_tracing = method == "trace";
+        } else if (arg == "--threads" && has_value) {
+            rank_threads = std::atoi(argv[++i]);
+            if (rank_threads == 0) rank_threads = omp_get_max_threads();
+        } else if (arg == "--headless") {
+            headless = true;
+        } else if (arg == "--output" && has_value) {
+            output = argv[++i];
+        } else if (arg == "--tiles") {
+            tiled = true;
+        } else if (arg == "--cache" && has_value) {
+            cache_dir = argv[++i];
+            tiled = true;
+        } else if (arg == "--center-x" && has_value) {
+            tiles.center_x = std::atof(argv[++i]);
+            tiled = true;
+        } else if (arg == "--center-y" && has_value) {
+            tiles.center_y = std::atof(argv[++i]);
+            tiled = true;
+        } else if (arg == "--zoom" && has_value) {
+            tiles.zoom = std::atoi(argv[++i]);
+            tiled = true;
+        } else {
+            valid = false;
+        }
+    }
+    if (schedule != "static" && schedule != "cyclic" && schedule != "dynamic") valid = false;
+    // Трассировке нужны сплошные прямоугольники: полосы static или тайлы, но не чередующиеся строки
+    if (boundary_tracing && !tiled && schedule != "static") valid = false;
+    // Безголовый режим пишет изображение потоком со своим распределением строк
+    if (headless && (tiled || boundary_tracing)) valid = false;
+    if (view.width < 1 || view.height < 1 || view.max_iter < 1 || rank_threads < 1) valid = false;
+    if (!valid) {
+        if (rank == 0) {
+            std::cerr << "Usage: " << argv[0] << " [--schedule static|cyclic|dynamic] [--kernel auto|avx512|avx2|scalar] [--method brute|trace]\n"
+                      << "       [--width N] [--height N] [--max-iter N] [--x-min X] [--x-max X] [--y-min Y] [--y-max Y]\n"
+                      << "       [--tiles] [--cache DIR] [--center-x X] [--center-y Y] [--zoom LEVEL]\n"
+                      << "       [--output FILE.png|FILE.ppm] [--headless] [--threads N|0]\n";
+        }
+        MPI_Finalize();
+        return 1;
+    }
 
+    // В тайловом режиме границы кадра выводятся из центра и масштаба, чтобы пиксели легли на сетку тайлов
+    if (tiled) {
+        double step = tile_step(tiles);
+        view.x_min = frame_origin(tiles.center_x, step, view.width) * step;
+        view.x_max = view.x_min + view.width * step;
+        view.y_min = frame_origin(tiles.center_y, step, view.height) * step;
+        view.y_max = view.y_min + view.height * step;
+        if (!cache_dir.empty() && rank == 0) {
+            std::filesystem::create_directories(cache_dir);
+        }
+        MPI_Barrier(MPI_COMM_WORLD);
+    }
+
+    std::string kernel_name;
+    row_kernel = select_kernel(kernel, kernel_name);
+    if (rank == 0) {
+        std::cout << "Kernel: " << kernel_name << "\n";
+        std::cout << "Layout: " << size << " ranks x " << rank_threads << " threads\n";
+        std::cout << "Viewport: [" << view.x_min << ", " << view.x_max << "] x [" << view.y_min << ", " << view.y_max
+                  << "], " << view.width << "x" << view.height << ", max_iter " << view.max_iter << "\n";
+    }
+
+    if (headless) {
+        MPI_Barrier(MPI_COMM_WORLD);
+        auto start = std::chrono::high_resolution_clock::now();
+        double busy = 0.0, color_time = 0.0, write_time = 0.0;
+        bool ok = render_stream(view, rank, size, output, busy, color_time, write_time);
+        double par_time = seconds_since(start);
+        double max_busy = 0.0, max_color = 0.0;
+        MPI_Reduce(&busy, &max_busy, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+        MPI_Reduce(&color_time, &max_color, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+        if (rank == 0) {
+            if (!ok) {
+                std::cerr << "Failed to write " << output << "\n";
+            } else {
+                std::cout << "Streamed " << output << " (" << size << " processes): " << par_time << " seconds\n";
+                std::cout << "Max compute per rank: " << max_busy << " s, max colorization per rank: " << max_color
+                          << " s, writing on rank 0: " << write_time << " s\n";
+            }
+        }
+        report_memory(rank, size);
+        MPI_Finalize();
+        return ok ? 0 : 1;
+    }
+
+    // Полнокадровые буферы нужны только рангу 0: остальные держат лишь свою полосу или свои тайлы
+    std::vector<int> buffer;
+    std::vector<int> seq_buffer;
+
+    double seq_time = 0.0;
+    if (rank == 0) {
+        buffer.resize((size_t)view.height * view.width);
+        seq_buffer.resize((size_t)view.height * view.width);
+        auto start = std::chrono::high_resolution_clock::now();
+        if (tiled) {
+            // Эталон для тайлового режима - те же тайлы без кэша на одном процессе
+            TileFrame frame = tile_frame(view, tiles);
+            std::vector<int> all_tiles;
+            CacheStats unused;
+            process_tiles(view, tiles, frame, "", mandelbrot_row_scalar, false, 0, 1, 1, all_tiles, unused);
+            assemble_tiles(view, frame, all_tiles, std::vector<int>(1, 0), 1, seq_buffer);
+        } else {
+            compute_mandelbrot_sequential(view, seq_buffer);
+        }
+        seq_time = seconds_since(start);
+        std::cout << "Sequential time (scalar kernel): " << seq_time << " seconds\n";
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    auto start = std::chrono::high_resolution_clock::now();
+
+    double busy = 0.0;
+    CacheStats stats;
+    if (tiled) {
+        render_tiled(view, tiles, cache_dir, rank, size, buffer, stats, busy);
+    } else if (schedule == "cyclic") {
+        render_cyclic(view, rank, size, buffer, busy);
+    } else if (schedule == "dynamic") {
+        render_dynamic(view, rank, size, buffer, busy);
+    } else {
+        render_static(view, rank, size, buffer, busy);
+    }
+
+    double par_time = seconds_since(start);
+
+    // Простой ранга - всё время параллельной части, не занятое вычислением пикселей
+    double idle = par_time - busy;
+    std::vector<double> all_busy(size), all_idle(size);
+    MPI_Gather(&busy, 1, MPI_DOUBLE, all_busy.data(), 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    MPI_Gather(&idle, 1, MPI_DOUBLE, all_idle.data(), 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+    long long total_skipped = 0;
+    MPI_Reduce(&skipped_pixels, &total_skipped, 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    CacheStats total;
+    if (tiled) {
+        MPI_Reduce(&stats.tiles, &total.tiles, 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+        MPI_Reduce(&stats.hits, &total.hits, 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+        MPI_Reduce(&stats.saved_seconds, &total.saved_seconds, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+        MPI_Reduce(&stats.compute_seconds, &total.compute_seconds, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+        MPI_Reduce(&stats.io_seconds, &total.io_seconds, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    }
+
+    cv::Mat image;
+    if (rank == 0) {
+        std::cout << "Parallel time (" << size << " processes x " << rank_threads << " threads, "
+                  << (tiled ? "tiled" : schedule) << " schedule): " << par_time << " seconds\n";
+        // Одинаковая строка для "-np 64" и "-np 1 --threads 64" позволяет сравнить гибрид с чистым MPI на тех же ядрах
+        int cores = size * rank_threads;
+        std::cout << "Strong scaling: " << cores << " cores, speedup " << seq_time / par_time
+                  << ", efficiency " << seq_time / par_time / cores << "\n";
+        double max_busy = 0.0, sum_busy = 0.0;
+        for (int p = 0; p < size; p++) {
+            std::cout << "Rank " << p << ": busy " << all_busy[p] << " s, idle " << all_idle[p] << " s\n";
+            max_busy = std::max(max_busy, all_busy[p]);
+            sum_busy += all_busy[p];
+        }
+        // Для dynamic ранг 0 только раздаёт работу, поэтому среднее считается по рабочим рангам
+        int computing = (!tiled && schedule == "dynamic" && size > 1) ? size - 1 : size;
+        if (sum_busy > 0.0) {
+            std::cout << "Load imbalance (max busy / mean busy): " << max_busy / (sum_busy / computing) << "\n";
+        }
+        if (tiled) {
+            std::cout << "Tiles: " << total.tiles << ", cache hits: " << total.hits << " (hit ratio "
+                      << (total.tiles ? (double)total.hits / total.tiles : 0.0) << ")\n";
+            std::cout << "Tile compute time: " << total.compute_seconds << " s, cache I/O time: " << total.io_seconds
+                      << " s, compute time saved by cache: " << total.saved_seconds << " s\n";
+        }
+        if (boundary_tracing) {
+            // В тайловом режиме пропуски считаются по пикселям вычисленных тайлов, в том числе вне кадра
+            double pixels = tiled ? (double)(total.tiles - total.hits) * TILE_SIZE * TILE_SIZE
+                                  : (double)view.width * view.height;
+            std::cout << "Pixels skipped by boundary tracing: " << total_skipped << " of " << (long long)pixels
+                      << (tiled ? " computed tile pixels" : "") << " (" << (pixels > 0.0 ? 100.0 * total_skipped / pixels : 0.0) << "%)\n";
+        }
+        std::cout << "Results match: " << (buffer == seq_buffer ? "Yes" : "No") << "\n";
+        if (buffer != seq_buffer) {
+            long long mismatched = 0;
+            for (size_t i = 0; i < buffer.size(); i++) mismatched += buffer[i] != seq_buffer[i];
+            std::cout << "Mismatched pixels: " << mismatched << "\n";
+        }
+
+        image = cv::Mat(view.height, view.width, CV_8UC3, cv::Scalar(0, 0, 0));
+        buffer_to_image(view, buffer, image, rank_threads);
+        cv::imwrite(output, image);
+    }
+
+    report_memory(rank, size);
     if (rank == 0) {
-        std::cout << "Parallel time (" << size << " processes): " << par_time << " seconds\n";
-        buffer_to_image(buffer, image);
-        cv::imwrite("mandelbrot.png", image);
         cv::imshow("Mandelbrot Set", image);
         cv::waitKey(0);
     }
 
     MPI_Finalize();
     return 0;
-}
\ No newline at end of file
+}
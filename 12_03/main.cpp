@@ -1,9 +1,17 @@
 #include <iostream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdio>
+#include <cstdint>
+#include <algorithm>
 #include <opencv2/opencv.hpp>
 #include <omp.h>
+#include "../common/image_stream.h"
 
 const int IMAGE_SIZE = 729;  
 const int MAX_DEPTH = 5;     
+const int STREAM_ROWS = 64;
 
 // Рекурсивная функция генерации ковра Серпинского
 void draw_sierpinski(cv::Mat& image, int x, int y, int size, int depth) {
@@ -22,17 +30,97 @@ void draw_sierpinski(cv::Mat& image, int x, int y, int size, int depth) {
     }
 }
 
-int main() {
-    cv::Mat image(IMAGE_SIZE, IMAGE_SIZE, CV_8UC3, cv::Scalar(255, 255, 255));
+// Цвет пикселя без рекурсии: спускаемся по тем же целочисленным третям, что и draw_sierpinski.
+// Пиксель чёрный, если на каком-то уровне он попал в центральную клетку; остаток от деления на 3 остаётся белым.
+bool is_black(int x, int y, int size, int depth) {
+    for (; depth > 0; depth--) {
+        int newSize = size / 3;
+        if (newSize == 0) return false;
+        int cx = x / newSize, cy = y / newSize;
+        if (cx > 2 || cy > 2) return false;
+        if (cx == 1 && cy == 1) return true;
+        x -= cx * newSize;
+        y -= cy * newSize;
+        size = newSize;
+    }
+    return false;
+}
+
+// Безголовый режим: полосы по STREAM_ROWS строк заполняются параллельно и сразу пишутся в файл
+bool render_stream(const std::string& path, int size, int depth, double& write_time) {
+    ImageStream stream;
+    if (!stream.open(path, size, size)) return false;
+    std::vector<unsigned char> rgb((size_t)STREAM_ROWS * size * 3);
+    write_time = 0.0;
+    for (int y0 = 0; y0 < size; y0 += STREAM_ROWS) {
+        int rows = std::min(STREAM_ROWS, size - y0);
+        #pragma omp parallel for schedule(static)
+        for (int r = 0; r < rows; r++) {
+            unsigned char* out = &rgb[(size_t)r * size * 3];
+            for (int x = 0; x < size; x++) {
+                std::memset(out + 3 * x, is_black(x, y0 + r, size, depth) ? 0 : 255, 3);
+            }
+        }
+        double start = omp_get_wtime();
+        stream.write_rows(rgb.data(), rows);
+        write_time += omp_get_wtime() - start;
+    }
+    double start = omp_get_wtime();
+    bool ok = stream.close();
+    write_time += omp_get_wtime() - start;
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    int size = IMAGE_SIZE;
+    int depth = MAX_DEPTH;
+    std::string output = "sierpinski_carpet.png";
+    bool headless = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--size" && has_value) {
+            size = std::atoi(argv[++i]);
+        } else if (arg == "--depth" && has_value) {
+            depth = std::atoi(argv[++i]);
+        } else if (arg == "--output" && has_value) {
+            output = argv[++i];
+        } else if (arg == "--headless") {
+            headless = true;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--size N] [--depth D] [--output FILE.png|FILE.ppm] [--headless]\n";
+            return 1;
+        }
+    }
+    if (size <= 0 || depth < 0) {
+        std::cerr << "Size must be positive and depth non-negative\n";
+        return 1;
+    }
+
+    // Без окна изображение целиком не хранится: строки считаются и пишутся потоком
+    if (headless) {
+        double start_time = omp_get_wtime();
+        double write_time = 0.0;
+        if (!render_stream(output, size, depth, write_time)) {
+            std::cerr << "Failed to write " << output << "\n";
+            return 1;
+        }
+        double end_time = omp_get_wtime();
+        std::cout << "Fractal streamed to " << output << " in " << (end_time - start_time)
+                  << " seconds (writing " << write_time << " s)\n";
+        return 0;
+    }
+
+    cv::Mat image(size, size, CV_8UC3, cv::Scalar(255, 255, 255));
 
     double start_time = omp_get_wtime();
 
-    draw_sierpinski(image, 0, 0, IMAGE_SIZE, MAX_DEPTH);
+    draw_sierpinski(image, 0, 0, size, depth);
 
     double end_time = omp_get_wtime();
     std::cout << "Fractal generated in " << (end_time - start_time) << " seconds\n";
 
-    cv::imwrite("sierpinski_carpet.png", image);
+    cv::imwrite(output, image);
     cv::imshow("Sierpinski Carpet", image);
     cv::waitKey(0);
     return 0;
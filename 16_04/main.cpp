@@ -7,9 +7,12 @@
 #include <chrono>
 #include <queue>
 #include <atomic>
+#include <string>
+#include <cstdlib>
+#include "../common/autotune.h"
 
 #define MAX_FRAMES 100 
-#define MAX_THREADS 4  
+#define MAX_THREADS 4  // число рабочих потоков, если в файле настроек машины нет подобранного
 
 std::mutex mtx; 
 
@@ -77,7 +80,7 @@ double process_sequential(cv::VideoCapture& cap, cv::CascadeClassifier& face_cas
 }
 
 double process_parallel(cv::VideoCapture& cap, cv::CascadeClassifier& face_cascade,
-                       cv::CascadeClassifier& eye_cascade, cv::CascadeClassifier& smile_cascade) {
+                       cv::CascadeClassifier& eye_cascade, cv::CascadeClassifier& smile_cascade, int workers) {
     auto start = std::chrono::high_resolution_clock::now();
     std::vector<std::thread> threads;
     std::queue<cv::Mat> frame_queue;
@@ -110,7 +113,7 @@ double process_parallel(cv::VideoCapture& cap, cv::CascadeClassifier& face_casca
         processed_frames++;
     }
 
-    for (int i = 0; i < MAX_THREADS; ++i) {
+    for (int i = 0; i < workers; ++i) {
         threads.emplace_back(worker);
     }
     for (auto& t : threads) {
@@ -137,7 +140,22 @@ double process_parallel(cv::VideoCapture& cap, cv::CascadeClassifier& face_casca
     return std::chrono::duration<double>(end - start).count();
 }
 
-int main() {
+int main(int argc, char** argv) {
+    bool tune = false;
+    TuneCache tune_cache;
+    tune_cache.path = default_tune_path("face_detection");
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--tune") {
+            tune = true;
+        } else if (arg == "--tune-file" && i + 1 < argc) {
+            tune_cache.path = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--tune] [--tune-file FILE]\n";
+            return 1;
+        }
+    }
+
     cv::CascadeClassifier face_cascade, eye_cascade, smile_cascade;
     if (!face_cascade.load("haarcascade_frontalface_default.xml") ||
         !eye_cascade.load("haarcascade_eye.xml") ||
@@ -156,14 +174,41 @@ int main() {
         }
     }
 
+    // Рабочие запуски берут число потоков из файла машины; --tune перебирает 1, 2, 4, ... до двойного числа ядер.
+    // Потоки здесь std::thread, поэтому из настроек используется только их число. Корзина - по ширине кадра
+    long long width = (long long)cap.get(cv::CAP_PROP_FRAME_WIDTH);
+    if (tune_cache.load()) {
+        std::cout << "Loaded " << tune_cache.size() << " tuned configurations from " << tune_cache.path << "\n";
+    }
+    TuneConfig fallback;
+    fallback.threads = MAX_THREADS;
+    TuneConfig config = tune_cache.lookup("frames", width, fallback);
+    if (tune) {
+        TuneSpace space;
+        space.max_threads = 2 * std::max(1u, std::thread::hardware_concurrency());
+        space.schedules = false;
+        config = autotune("frames", config, space, [&](const TuneConfig& candidate) {
+            cap.set(cv::CAP_PROP_POS_FRAMES, 0);
+            process_parallel(cap, face_cascade, eye_cascade, smile_cascade, config_threads(candidate));
+        });
+        tune_cache.store("frames", width, config);
+        if (!tune_cache.save()) {
+            std::cerr << "Failed to write " << tune_cache.path << "\n";
+            return 1;
+        }
+        std::cout << "Saved tuning for size bucket " << size_bucket(width) << " to " << tune_cache.path << "\n";
+        cap.set(cv::CAP_PROP_POS_FRAMES, 0);
+    }
+    int workers = config_threads(config);
+
     std::cout << "Running sequential processing...\n";
     double seq_time = process_sequential(cap, face_cascade, eye_cascade, smile_cascade);
     std::cout << "Sequential time: " << seq_time << " seconds\n";
 
     cap.set(cv::CAP_PROP_POS_FRAMES, 0);
 
-    std::cout << "Running parallel processing...\n";
-    double par_time = process_parallel(cap, face_cascade, eye_cascade, smile_cascade);
+    std::cout << "Running parallel processing (" << workers << " workers)...\n";
+    double par_time = process_parallel(cap, face_cascade, eye_cascade, smile_cascade, workers);
     std::cout << "Parallel time: " << par_time << " seconds\n";
 
     double speedup = seq_time / par_time;
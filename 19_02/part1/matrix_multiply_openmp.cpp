@@ -2,20 +2,64 @@
 #include <vector>
 #include <random>
 #include <chrono>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <memory>
 #include <omp.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "../../common/autotune.h"
+#include "../../common/matrix_file.h"
+#include "../../common/precision.h"
 
 #define M 1000
 #define N 1000
 #define P 1000
 
-using Matrix = std::vector<std::vector<double>>;
+// Блочное умножение в стиле GotoBLAS: микроядро MR x NR держит блок C в регистрах,
+// полоса A (MC x KC) живёт в L2, панель B (KC x NC) - в L3, макротайлы MC x NB делятся между потоками
+#define MR 6
+#define NR 8
+#define MC 96
+#define KC 256
+#define NC 4096
+#define NB 256
+
+// Штрассен - Виноград: рекурсия до размера STRASSEN_CUTOFF, дальше блочный gemm;
+// семь подпроизведений идут задачами OpenMP на верхних уровнях (по умолчанию - пока задач меньше, чем потоков)
+#define STRASSEN_CUTOFF 256
+
+// Обобщённое по типу умножение считает C тайлами TYPED_TILE x TYPED_TILE через строки A и B^T
+#define TYPED_TILE 64
+
+// Умножение вне памяти: полосы по OOC_PANEL строк A и столбцов B читаются из отображённых файлов,
+// в памяти одновременно только панель B (n x OOC_PANEL), полоса A (OOC_PANEL x n) и блок C
+#define OOC_PANEL 1024
+#define CHECK_SAMPLES 64
+
+// Матрица в одном непрерывном блоке памяти, построчно
+struct Matrix {
+    int rows = 0;
+    int cols = 0;
+    std::vector<double> data;
+
+    double* operator[](int i) { return &data[(size_t)i * cols]; }
+    const double* operator[](int i) const { return &data[(size_t)i * cols]; }
+};
 
 void initialize_matrix(Matrix& mat, int rows, int cols) {
     std::random_device rd;
     std::mt19937 gen(rd());
     std::uniform_real_distribution<> dis(0.0, 10.0);
 
-    mat.resize(rows, std::vector<double>(cols));
+    mat.rows = rows;
+    mat.cols = cols;
+    mat.data.resize((size_t)rows * cols);
     for (int i = 0; i < rows; ++i) {
         for (int j = 0; j < cols; ++j) {
             mat[i][j] = dis(gen);
@@ -24,58 +68,754 @@ void initialize_matrix(Matrix& mat, int rows, int cols) {
 }
 
 void multiply_sequential(const Matrix& A, const Matrix& B, Matrix& C) {
-    for (int i = 0; i < M; ++i) {
-        for (int j = 0; j < P; ++j) {
+    for (int i = 0; i < A.rows; ++i) {
+        for (int j = 0; j < B.cols; ++j) {
             C[i][j] = 0.0;
-            for (int k = 0; k < N; ++k) {
+            for (int k = 0; k < A.cols; ++k) {
                 C[i][j] += A[i][k] * B[k][j];
             }
         }
     }
 }
 
-void multiply_parallel(const Matrix& A, const Matrix& B, Matrix& C) {
-    #pragma omp parallel for schedule(dynamic)
-    for (int i = 0; i < M; ++i) {
-        for (int j = 0; j < P; ++j) {
+TuneCache tune_cache;
+
+// Настройки по умолчанию повторяют прежние ручные: наивное умножение - schedule(dynamic) по строкам,
+// блочное - schedule(dynamic) по макротайлам высотой MC
+TuneConfig parallel_defaults() {
+    TuneConfig config;
+    config.schedule = omp_sched_dynamic;
+    return config;
+}
+
+TuneConfig blocked_defaults() {
+    TuneConfig config;
+    config.schedule = omp_sched_dynamic;
+    config.tile = MC;
+    return config;
+}
+
+void multiply_parallel(const Matrix& A, const Matrix& B, Matrix& C, const TuneConfig& config) {
+    omp_set_schedule(config.schedule, config.chunk);
+    #pragma omp parallel for schedule(runtime) num_threads(config_threads(config))
+    for (int i = 0; i < A.rows; ++i) {
+        for (int j = 0; j < B.cols; ++j) {
             C[i][j] = 0.0;
-            for (int k = 0; k < N; ++k) {
+            for (int k = 0; k < A.cols; ++k) {
                 C[i][j] += A[i][k] * B[k][j];
             }
         }
     }
 }
 
-int main() {
-    Matrix A, B, C_seq, C_par;
-    
-    initialize_matrix(A, M, N);
-    initialize_matrix(B, N, P);
-    initialize_matrix(C_seq, M, P);
-    initialize_matrix(C_par, M, P);
+void multiply_parallel(const Matrix& A, const Matrix& B, Matrix& C) {
+    multiply_parallel(A, B, C, tune_cache.lookup("parallel", std::max(A.rows, B.cols), parallel_defaults()));
+}
+
+// Микроядро: c (MR x NR, шаг ldc) = или += сумма по p от a[p] * b[p]^T,
+// где a - упакованная полоса A (по MR чисел на шаг), b - упакованная полоса B (по NR чисел на шаг)
+typedef void (*Microkernel)(int kc, const double* a, const double* b, double* c, int ldc, bool accumulate);
+
+void microkernel_scalar(int kc, const double* a, const double* b, double* c, int ldc, bool accumulate) {
+    double acc[MR][NR] = {};
+    for (int p = 0; p < kc; p++) {
+        for (int r = 0; r < MR; r++) {
+            for (int j = 0; j < NR; j++) {
+                acc[r][j] += a[r] * b[j];
+            }
+        }
+        a += MR;
+        b += NR;
+    }
+    for (int r = 0; r < MR; r++) {
+        for (int j = 0; j < NR; j++) {
+            c[r * ldc + j] = accumulate ? c[r * ldc + j] + acc[r][j] : acc[r][j];
+        }
+    }
+}
+
+#if SIMD_KERNELS
+// 12 регистров-аккумуляторов (6 строк по два вектора из 4 double), 2 под строку B и 1 под рассылку A
+__attribute__((target("avx2,fma")))
+void microkernel_avx2(int kc, const double* a, const double* b, double* c, int ldc, bool accumulate) {
+    __m256d c00 = _mm256_setzero_pd(), c01 = _mm256_setzero_pd();
+    __m256d c10 = _mm256_setzero_pd(), c11 = _mm256_setzero_pd();
+    __m256d c20 = _mm256_setzero_pd(), c21 = _mm256_setzero_pd();
+    __m256d c30 = _mm256_setzero_pd(), c31 = _mm256_setzero_pd();
+    __m256d c40 = _mm256_setzero_pd(), c41 = _mm256_setzero_pd();
+    __m256d c50 = _mm256_setzero_pd(), c51 = _mm256_setzero_pd();
+    for (int p = 0; p < kc; p++) {
+        __m256d b0 = _mm256_loadu_pd(b);
+        __m256d b1 = _mm256_loadu_pd(b + 4);
+        __m256d ar;
+        ar = _mm256_broadcast_sd(a + 0); c00 = _mm256_fmadd_pd(ar, b0, c00); c01 = _mm256_fmadd_pd(ar, b1, c01);
+        ar = _mm256_broadcast_sd(a + 1); c10 = _mm256_fmadd_pd(ar, b0, c10); c11 = _mm256_fmadd_pd(ar, b1, c11);
+        ar = _mm256_broadcast_sd(a + 2); c20 = _mm256_fmadd_pd(ar, b0, c20); c21 = _mm256_fmadd_pd(ar, b1, c21);
+        ar = _mm256_broadcast_sd(a + 3); c30 = _mm256_fmadd_pd(ar, b0, c30); c31 = _mm256_fmadd_pd(ar, b1, c31);
+        ar = _mm256_broadcast_sd(a + 4); c40 = _mm256_fmadd_pd(ar, b0, c40); c41 = _mm256_fmadd_pd(ar, b1, c41);
+        ar = _mm256_broadcast_sd(a + 5); c50 = _mm256_fmadd_pd(ar, b0, c50); c51 = _mm256_fmadd_pd(ar, b1, c51);
+        a += MR;
+        b += NR;
+    }
+    __m256d rows[MR][2] = { { c00, c01 }, { c10, c11 }, { c20, c21 }, { c30, c31 }, { c40, c41 }, { c50, c51 } };
+    for (int r = 0; r < MR; r++) {
+        double* out = c + r * ldc;
+        if (accumulate) {
+            rows[r][0] = _mm256_add_pd(rows[r][0], _mm256_loadu_pd(out));
+            rows[r][1] = _mm256_add_pd(rows[r][1], _mm256_loadu_pd(out + 4));
+        }
+        _mm256_storeu_pd(out, rows[r][0]);
+        _mm256_storeu_pd(out + 4, rows[r][1]);
+    }
+}
+#endif
+
+Microkernel select_microkernel(std::string& name) {
+#if SIMD_KERNELS
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        name = "avx2+fma";
+        return microkernel_avx2;
+    }
+#endif
+    name = "scalar";
+    return microkernel_scalar;
+}
+
+Microkernel microkernel = microkernel_scalar;
+
+// Полосы по MR строк блока A (rows x kc): внутри полосы элементы идут по столбцам, хвост дополняется нулями.
+// Пакует один поток - в свой буфер
+void pack_a(int rows, int kc, const double* A, int lda, double* packed) {
+    for (int s = 0; s < (rows + MR - 1) / MR; s++) {
+        double* out = packed + (size_t)s * MR * kc;
+        for (int p = 0; p < kc; p++) {
+            for (int r = 0; r < MR; r++) {
+                int i = s * MR + r;
+                out[p * MR + r] = (i < rows) ? A[(size_t)i * lda + p] : 0.0;
+            }
+        }
+    }
+}
+
+// Полосы по NR столбцов блока B (kc x cols): внутри полосы элементы идут по строкам, хвост дополняется нулями
+void pack_b(int kc, int cols, const double* B, int ldb, double* packed) {
+    #pragma omp for schedule(static)
+    for (int t = 0; t < (cols + NR - 1) / NR; t++) {
+        double* out = packed + (size_t)t * NR * kc;
+        for (int p = 0; p < kc; p++) {
+            const double* row = B + (size_t)p * ldb + t * NR;
+            for (int j = 0; j < NR; j++) {
+                out[p * NR + j] = (t * NR + j < cols) ? row[j] : 0.0;
+            }
+        }
+    }
+}
+
+// C (m x n) = A (m x k) * B (k x n) для построчных матриц с шагами строк lda, ldb, ldc.
+// config: потоки, расписание макротайлов и высота макротайла (кратна MR)
+void gemm(int m, int n, int k, const double* A, int lda, const double* B, int ldb, double* C, int ldc,
+          const TuneConfig& config) {
+    if (m <= 0 || n <= 0) return;
+    if (k <= 0) {
+        for (int i = 0; i < m; i++) std::fill(C + (size_t)i * ldc, C + (size_t)i * ldc + n, 0.0);
+        return;
+    }
+    int mc = config.tile > 0 ? config.tile / MR * MR : MC;
+    if (mc < MR) mc = MR;
+
+    // Буферы упаковки переиспользуются между вызовами (листья Штрассена зовут gemm тысячи раз).
+    // Панель B общая и принадлежит вызывающему потоку, блок A (mc x kc) у каждого потока команды свой
+    static thread_local std::vector<double> packed_a_buffer, packed_b_buffer;
+    size_t a_size = (size_t)((std::min(mc, m) + MR - 1) / MR * MR) * KC;
+    size_t b_size = (size_t)KC * ((std::min(n, NC) + NR - 1) / NR * NR);
+    if (packed_b_buffer.size() < b_size) packed_b_buffer.resize(b_size);
+    double* packed_b = packed_b_buffer.data();
+
+    omp_set_schedule(config.schedule, config.chunk);
+    #pragma omp parallel num_threads(config_threads(config))
+    {
+        std::vector<double>& own_a = packed_a_buffer;
+        if (own_a.size() < a_size) own_a.resize(a_size);
+        double* packed_a = own_a.data();
+
+        for (int jc = 0; jc < n; jc += NC) {
+            int nc = std::min(NC, n - jc);
+            for (int pc = 0; pc < k; pc += KC) {
+                int kc = std::min(KC, k - pc);
+                pack_b(kc, nc, B + (size_t)pc * ldb + jc, ldb, packed_b);
+
+                // Неявный барьер после упаковки B: дальше все потоки читают общую панель.
+                // Блок A пакуется, когда у потока сменился ic; соседние итерации с тем же ic (другие jt) его переиспользуют
+                int packed_ic = -1;
+                #pragma omp for collapse(2) schedule(runtime)
+                for (int ic = 0; ic < m; ic += mc) {
+                    for (int jt = 0; jt < nc; jt += NB) {
+                        if (packed_ic != ic) {
+                            pack_a(std::min(mc, m - ic), kc, A + (size_t)ic * lda + pc, lda, packed_a);
+                            packed_ic = ic;
+                        }
+                        double edge[MR * NR];
+                        for (int jr = jt; jr < std::min(jt + NB, nc); jr += NR) {
+                            const double* b = packed_b + (size_t)(jr / NR) * NR * kc;
+                            int nr = std::min(NR, nc - jr);
+                            for (int ir = ic; ir < std::min(ic + mc, m); ir += MR) {
+                                const double* a = packed_a + (size_t)((ir - ic) / MR) * MR * kc;
+                                int mr = std::min(MR, m - ir);
+                                double* c = C + (size_t)ir * ldc + jc + jr;
+                                if (mr == MR && nr == NR) {
+                                    microkernel(kc, a, b, c, ldc, pc > 0);
+                                    continue;
+                                }
+                                // Краевой блок считается целиком во временный буфер, в C копируется только его часть
+                                microkernel(kc, a, b, edge, NR, false);
+                                for (int r = 0; r < mr; r++) {
+                                    for (int j = 0; j < nr; j++) {
+                                        c[(size_t)r * ldc + j] = (pc > 0 ? c[(size_t)r * ldc + j] : 0.0) + edge[r * NR + j];
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+void multiply_blocked(const Matrix& A, const Matrix& B, Matrix& C, const TuneConfig& config) {
+    gemm(A.rows, B.cols, A.cols, A.data.data(), A.cols, B.data.data(), B.cols, C.data.data(), C.cols, config);
+}
+
+void multiply_blocked(const Matrix& A, const Matrix& B, Matrix& C) {
+    multiply_blocked(A, B, C, tune_cache.lookup("blocked", std::max(A.rows, B.cols), blocked_defaults()));
+}
+
+// Z = X + sign * Y для блоков rows x cols с шагами строк ldx, ldy, ldz
+void add_blocks(int rows, int cols, const double* X, int ldx, const double* Y, int ldy, double sign, double* Z, int ldz) {
+    for (int i = 0; i < rows; i++) {
+        const double* x = X + (size_t)i * ldx;
+        const double* y = Y + (size_t)i * ldy;
+        double* z = Z + (size_t)i * ldz;
+        for (int j = 0; j < cols; j++) {
+            z[j] = x[j] + sign * y[j];
+        }
+    }
+}
+
+// Временные блоки рекурсии выделяются один раз: на уровне l по слоту на каждый одновременно живой узел.
+// Выше task_depth узлы уровня работают параллельно (7^l слотов), ниже дети идут по очереди и делят слот родителя.
+// Слот: S1..S4 (m2 x k2), T1..T4 (k2 x n2), P1, P6, P7 (m2 x n2); остальные произведения пишутся прямо в четверти C.
+struct StrassenArena {
+    int levels = 0;
+    int task_depth = 0;
+    std::vector<int> half_m, half_n, half_k;
+    std::vector<size_t> slot_size;
+    std::vector<size_t> slot_count;
+    std::vector<std::unique_ptr<double[]>> memory;
+
+    StrassenArena(int m, int n, int k, int level_count, int tasks) : levels(level_count), task_depth(tasks) {
+        for (int l = 0; l < levels; l++) {
+            int m2 = m >> (l + 1), n2 = n >> (l + 1), k2 = k >> (l + 1);
+            size_t size = 4 * (size_t)m2 * k2 + 4 * (size_t)k2 * n2 + 3 * (size_t)m2 * n2;
+            size_t slots = 1;
+            for (int d = 0; d < std::min(l, task_depth); d++) slots *= 7;
+            half_m.push_back(m2);
+            half_n.push_back(n2);
+            half_k.push_back(k2);
+            slot_size.push_back(size);
+            slot_count.push_back(slots);
+            // Без обнуления: страницы впервые трогает поток, который считает узел
+            memory.emplace_back(new double[slots * size]);
+        }
+    }
+
+    double* slot(int level, size_t index) { return memory[level].get() + index * slot_size[level]; }
+
+    size_t bytes() const {
+        size_t total = 0;
+        for (int l = 0; l < levels; l++) total += slot_count[l] * slot_size[l] * sizeof(double);
+        return total;
+    }
+};
+
+// Листья считает gemm с настройками leaf, подобранными для размера листа
+void strassen_level(StrassenArena& arena, const TuneConfig& leaf, int level, size_t slot, int m, int n, int k,
+                    const double* A, int lda, const double* B, int ldb, double* C, int ldc) {
+    if (level == arena.levels) {
+        gemm(m, n, k, A, lda, B, ldb, C, ldc, leaf);
+        return;
+    }
+    int m2 = m / 2, n2 = n / 2, k2 = k / 2;
+    const double *A11 = A, *A12 = A + k2, *A21 = A + (size_t)m2 * lda, *A22 = A21 + k2;
+    const double *B11 = B, *B12 = B + n2, *B21 = B + (size_t)k2 * ldb, *B22 = B21 + n2;
+    double *C11 = C, *C12 = C + n2, *C21 = C + (size_t)m2 * ldc, *C22 = C21 + n2;
+
+    double* S[4];
+    double* T[4];
+    double* work = arena.slot(level, slot);
+    for (int i = 0; i < 4; i++, work += (size_t)m2 * k2) S[i] = work;
+    for (int i = 0; i < 4; i++, work += (size_t)k2 * n2) T[i] = work;
+    double* P1 = work;
+    double* P6 = P1 + (size_t)m2 * n2;
+    double* P7 = P6 + (size_t)m2 * n2;
+
+    add_blocks(m2, k2, A21, lda, A22, lda, 1.0, S[0], k2);     // S1 = A21 + A22
+    add_blocks(m2, k2, S[0], k2, A11, lda, -1.0, S[1], k2);    // S2 = S1 - A11
+    add_blocks(m2, k2, A11, lda, A21, lda, -1.0, S[2], k2);    // S3 = A11 - A21
+    add_blocks(m2, k2, A12, lda, S[1], k2, -1.0, S[3], k2);    // S4 = A12 - S2
+    add_blocks(k2, n2, B12, ldb, B11, ldb, -1.0, T[0], n2);    // T1 = B12 - B11
+    add_blocks(k2, n2, B22, ldb, T[0], n2, -1.0, T[1], n2);    // T2 = B22 - T1
+    add_blocks(k2, n2, B22, ldb, B12, ldb, -1.0, T[2], n2);    // T3 = B22 - B12
+    add_blocks(k2, n2, T[1], n2, B21, ldb, -1.0, T[3], n2);    // T4 = T2 - B21
+
+    // P2..P5 пишутся во временно свободные четверти C, итог собирается одним проходом ниже
+    bool spawn = level < arena.task_depth;
+    auto child = [&](int i) { return spawn ? slot * 7 + i : slot; };
+    #pragma omp task if (spawn) shared(arena, leaf)
+    strassen_level(arena, leaf, level + 1, child(0), m2, n2, k2, A11, lda, B11, ldb, P1, n2);
+    #pragma omp task if (spawn) shared(arena, leaf)
+    strassen_level(arena, leaf, level + 1, child(1), m2, n2, k2, A12, lda, B21, ldb, C11, ldc);
+    #pragma omp task if (spawn) shared(arena, leaf)
+    strassen_level(arena, leaf, level + 1, child(2), m2, n2, k2, S[3], k2, B22, ldb, C12, ldc);
+    #pragma omp task if (spawn) shared(arena, leaf)
+    strassen_level(arena, leaf, level + 1, child(3), m2, n2, k2, A22, lda, T[3], n2, C21, ldc);
+    #pragma omp task if (spawn) shared(arena, leaf)
+    strassen_level(arena, leaf, level + 1, child(4), m2, n2, k2, S[0], k2, T[0], n2, C22, ldc);
+    #pragma omp task if (spawn) shared(arena, leaf)
+    strassen_level(arena, leaf, level + 1, child(5), m2, n2, k2, S[1], k2, T[1], n2, P6, n2);
+    #pragma omp task if (spawn) shared(arena, leaf)
+    strassen_level(arena, leaf, level + 1, child(6), m2, n2, k2, S[2], k2, T[2], n2, P7, n2);
+    #pragma omp taskwait
+
+    // C11 = P1 + P2, C12 = U2 + P5 + P3, C21 = U3 - P4, C22 = U3 + P5, где U2 = P1 + P6, U3 = U2 + P7
+    for (int i = 0; i < m2; i++) {
+        double* c11 = C11 + (size_t)i * ldc;
+        double* c12 = C12 + (size_t)i * ldc;
+        double* c21 = C21 + (size_t)i * ldc;
+        double* c22 = C22 + (size_t)i * ldc;
+        const double* p1 = P1 + (size_t)i * n2;
+        const double* p6 = P6 + (size_t)i * n2;
+        const double* p7 = P7 + (size_t)i * n2;
+        for (int j = 0; j < n2; j++) {
+            double u2 = p1[j] + p6[j];
+            double u3 = u2 + p7[j];
+            double p5 = c22[j];
+            c11[j] = p1[j] + c11[j];
+            c12[j] = u2 + p5 + c12[j];
+            c21[j] = u3 - c21[j];
+            c22[j] = u3 + p5;
+        }
+    }
+}
+
+// Глубина задач по умолчанию: наименьшая, на которой одновременно живых узлов не меньше, чем потоков
+int default_task_depth() {
+    int depth = 0;
+    for (int tasks = 1; tasks < omp_get_max_threads(); tasks *= 7) depth++;
+    return depth;
+}
+
+// Число уровней - пока все три размера больше cutoff; размеры дополняются нулями до кратных 2^levels
+size_t multiply_strassen(const Matrix& A, const Matrix& B, Matrix& C, int cutoff, int task_depth) {
+    int m = A.rows, n = B.cols, k = A.cols;
+    int levels = 0;
+    auto halved = [&](int d) { return (d + (1 << levels) - 1) >> levels; };
+    while (levels < 20 && halved(m) > cutoff && halved(n) > cutoff && halved(k) > cutoff) levels++;
+    int unit = 1 << levels;
+    int mp = (m + unit - 1) / unit * unit, np = (n + unit - 1) / unit * unit, kp = (k + unit - 1) / unit * unit;
+    TuneConfig leaf = tune_cache.lookup("blocked", std::max(mp, np) >> levels, blocked_defaults());
+    if (levels == 0) {
+        // Без рекурсии - сразу параллельный gemm, а не команда из одного потока внутри single
+        gemm(m, n, k, A.data.data(), k, B.data.data(), n, C.data.data(), n, leaf);
+        return 0;
+    }
+
+    const Matrix* a = &A;
+    const Matrix* b = &B;
+    Matrix* c = &C;
+    Matrix A_pad, B_pad, C_pad;
+    bool padded = mp != m || np != n || kp != k;
+    if (padded) {
+        A_pad.rows = mp; A_pad.cols = kp; A_pad.data.assign((size_t)mp * kp, 0.0);
+        B_pad.rows = kp; B_pad.cols = np; B_pad.data.assign((size_t)kp * np, 0.0);
+        C_pad.rows = mp; C_pad.cols = np; C_pad.data.assign((size_t)mp * np, 0.0);
+        for (int i = 0; i < m; i++) std::copy(A[i], A[i] + k, A_pad[i]);
+        for (int i = 0; i < k; i++) std::copy(B[i], B[i] + n, B_pad[i]);
+        a = &A_pad;
+        b = &B_pad;
+        c = &C_pad;
+    }
+
+    StrassenArena arena(mp, np, kp, levels, task_depth);
+    #pragma omp parallel
+    #pragma omp single
+    strassen_level(arena, leaf, 0, 0, mp, np, kp, a->data.data(), kp, b->data.data(), np, c->data.data(), np);
+
+    if (padded) {
+        for (int i = 0; i < m; i++) std::copy(C_pad[i], C_pad[i] + n, C[i]);
+    }
+    return arena.bytes();
+}
+
+// Наибольшая по модулю разность, отнесённая к наибольшему по модулю элементу эталона
+double max_relative_error(const Matrix& expected, const Matrix& actual) {
+    double max_diff = 0.0, max_value = 0.0;
+    for (size_t i = 0; i < expected.data.size(); i++) {
+        max_diff = std::max(max_diff, std::abs(expected.data[i] - actual.data[i]));
+        max_value = std::max(max_value, std::abs(expected.data[i]));
+    }
+    return max_value > 0.0 ? max_diff / max_value : max_diff;
+}
+
+bool results_match(const Matrix& expected, const Matrix& actual) {
+    for (int i = 0; i < expected.rows; ++i) {
+        for (int j = 0; j < expected.cols; ++j) {
+            if (std::abs(expected[i][j] - actual[i][j]) > 1e-6) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+double gflops(int m, int n, int p, double seconds) {
+    return 2.0 * m * n * p / seconds / 1e9;
+}
+
+// C (m x p, тип Acc) = A (m x n) * B, где B передана транспонированной (Bt: p x n), чтобы оба сомножителя шли подряд
+template<typename T, typename Acc>
+void multiply_typed(const std::vector<T>& A, const std::vector<T>& Bt, std::vector<Acc>& C, int m, int n, int p) {
+    C.resize((size_t)m * p);
+    #pragma omp parallel for collapse(2) schedule(dynamic)
+    for (int ib = 0; ib < m; ib += TYPED_TILE) {
+        for (int jb = 0; jb < p; jb += TYPED_TILE) {
+            for (int i = ib; i < std::min(ib + TYPED_TILE, m); ++i) {
+                for (int j = jb; j < std::min(jb + TYPED_TILE, p); ++j) {
+                    C[(size_t)i * p + j] = dot<T, Acc>(&A[(size_t)i * n], &Bt[(size_t)j * n], n);
+                }
+            }
+        }
+    }
+}
+
+template void multiply_typed<double, double>(const std::vector<double>&, const std::vector<double>&, std::vector<double>&, int, int, int);
+template void multiply_typed<float, float>(const std::vector<float>&, const std::vector<float>&, std::vector<float>&, int, int, int);
+template void multiply_typed<bf16, float>(const std::vector<bf16>&, const std::vector<bf16>&, std::vector<float>&, int, int, int);
+template void multiply_typed<int8_t, int32_t>(const std::vector<int8_t>&, const std::vector<int8_t>&, std::vector<int32_t>&, int, int, int);
+
+// A и B переводятся в T (B - сразу транспонированной); эталон - блочное произведение в double.
+// В байты входят оба сомножителя в T и результат в Acc
+template<typename T, typename Acc>
+void run_precision(const char* name, const Matrix& A, const Matrix& B, const Matrix& reference) {
+    int m = A.rows, n = A.cols, p = B.cols;
+    std::vector<double> Bt((size_t)p * n);
+    for (int k = 0; k < n; ++k)
+        for (int j = 0; j < p; ++j) Bt[(size_t)j * n + k] = B[k][j];
+    double scale_a = storage_scale<T>(A.data), scale_b = storage_scale<T>(Bt);
+    std::vector<T> typed_A = encode_all<T>(A.data, scale_a);
+    std::vector<T> typed_Bt = encode_all<T>(Bt, scale_b);
+    std::vector<Acc> C;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    multiply_typed<T, Acc>(typed_A, typed_Bt, C, m, n, p);
+    double time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+    Matrix decoded;
+    decoded.rows = m;
+    decoded.cols = p;
+    decoded.data.resize(C.size());
+    for (size_t i = 0; i < C.size(); ++i) decoded.data[i] = (double)C[i] * scale_a * scale_b;
+    double bytes = ((double)m * n + (double)n * p) * sizeof(T) + (double)m * p * sizeof(Acc);
+    std::cout << name << ": " << time << " seconds (" << gflops(m, n, p, time) << " GFLOP/s), "
+              << bytes / (1024.0 * 1024.0) << " MB moved, max relative error " << max_relative_error(reference, decoded) << "\n";
+}
+
+struct OutOfCoreStats {
+    double io_time = 0.0, compute_time = 0.0, io_bytes = 0.0;
+};
+
+// C = A * B над отображёнными файлами: для каждой панели столбцов B перебираются полосы строк A.
+// Чтение полосы - копирование из отображения (здесь происходят страничные промахи и чтение с диска),
+// пока считается текущая полоса, ядро по MADV_WILLNEED уже читает следующую; прочитанная полоса отпускается MADV_DONTNEED
+OutOfCoreStats multiply_out_of_core(const MappedMatrix& A, const MappedMatrix& B, MappedMatrix& C, int panel) {
+    int m = (int)A.rows, n = (int)A.cols, p = (int)B.cols;
+    std::vector<double> b_panel((size_t)n * std::min(panel, p));
+    std::vector<double> a_panel((size_t)std::min(panel, m) * n);
+    std::vector<double> c_panel((size_t)std::min(panel, m) * std::min(panel, p));
+    OutOfCoreStats stats;
+    TuneConfig config = tune_cache.lookup("blocked", std::min(panel, std::max(m, p)), blocked_defaults());
+    A.advise(0, std::min(panel, m), MADV_WILLNEED);
+
+    for (int j0 = 0; j0 < p; j0 += panel) {
+        int nb = std::min(panel, p - j0);
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int k = 0; k < n; ++k) {
+            std::memcpy(&b_panel[(size_t)k * nb], B.row(k) + j0, nb * sizeof(double));
+        }
+        stats.io_time += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+        stats.io_bytes += (double)n * nb * sizeof(double);
+
+        for (int i0 = 0; i0 < m; i0 += panel) {
+            int mb = std::min(panel, m - i0);
+            // Следующая полоса A: ниже по строкам или первая полоса для следующей панели B
+            int next = i0 + panel < m ? i0 + panel : (j0 + panel < p ? 0 : m);
+            A.advise(next, std::min(panel, m - next), MADV_WILLNEED);
+
+            start = std::chrono::high_resolution_clock::now();
+            std::memcpy(a_panel.data(), A.row(i0), (size_t)mb * n * sizeof(double));
+            A.advise(i0, mb, MADV_DONTNEED);
+            stats.io_time += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+            start = std::chrono::high_resolution_clock::now();
+            gemm(mb, nb, n, a_panel.data(), n, b_panel.data(), nb, c_panel.data(), nb, config);
+            stats.compute_time += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+            start = std::chrono::high_resolution_clock::now();
+            for (int r = 0; r < mb; ++r) {
+                std::memcpy(C.row(i0 + r) + j0, &c_panel[(size_t)r * nb], nb * sizeof(double));
+            }
+            stats.io_time += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+            stats.io_bytes += (double)mb * n * sizeof(double) + (double)mb * nb * sizeof(double);
+        }
+    }
+    auto start = std::chrono::high_resolution_clock::now();
+    C.sync();
+    stats.io_time += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    return stats;
+}
+
+// Режим --a/--b/--c: недостающие A и B создаются по --m/--n/--p, C перезаписывается.
+// Проверка - CHECK_SAMPLES случайных элементов C против скалярных произведений прямо по файлам
+int run_out_of_core(const std::string& path_a, const std::string& path_b, const std::string& path_c,
+                    int m, int n, int p, int panel) {
+    MappedMatrix A, B, C;
+    std::string error;
+    if (!open_or_generate(A, path_a, m, n, 1, error) || !open_or_generate(B, path_b, n, p, 2, error)) {
+        std::cerr << error << "\n";
+        return 1;
+    }
+    if (A.cols != B.rows) {
+        std::cerr << "Inner dimensions differ: A is " << A.rows << "x" << A.cols << ", B is " << B.rows << "x" << B.cols << "\n";
+        return 1;
+    }
+    m = (int)A.rows;
+    n = (int)A.cols;
+    p = (int)B.cols;
+    if (!C.create(path_c, m, p, error)) {
+        std::cerr << error << "\n";
+        return 1;
+    }
+
+    double resident = ((double)n * std::min(panel, p) + (double)std::min(panel, m) * n
+                       + (double)std::min(panel, m) * std::min(panel, p)) * sizeof(double);
+    std::cout << "Out-of-core multiply " << m << "x" << n << " * " << n << "x" << p << ", panel " << panel
+              << ", resident buffers " << resident / (1024.0 * 1024.0) << " MB, files "
+              << ((double)m * n + (double)n * p + (double)m * p) * sizeof(double) / (1024.0 * 1024.0) << " MB\n";
+
+    auto start = std::chrono::high_resolution_clock::now();
+    OutOfCoreStats stats = multiply_out_of_core(A, B, C, panel);
+    double total = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    std::cout << "Total time: " << total << " seconds\n";
+    std::cout << "I/O: " << stats.io_time << " s, " << stats.io_bytes / (1024.0 * 1024.0) << " MB, "
+              << stats.io_bytes / stats.io_time / 1e9 << " GB/s\n";
+    std::cout << "Compute: " << stats.compute_time << " s, " << gflops(m, n, p, stats.compute_time) << " GFLOP/s\n";
+
+    std::mt19937 gen(7);
+    double max_error = 0.0;
+    for (int s = 0; s < CHECK_SAMPLES; ++s) {
+        int i = gen() % m, j = gen() % p;
+        double expected = 0.0;
+        for (int k = 0; k < n; ++k) expected += A.row(i)[k] * B.row(k)[j];
+        max_error = std::max(max_error, std::abs(expected - C.row(i)[j]) / std::max(1.0, std::abs(expected)));
+    }
+    std::cout << "Results match (" << CHECK_SAMPLES << " sampled entries): " << (max_error <= 1e-9 ? "Yes" : "No")
+              << " (max relative error " << max_error << ")\n";
+    return max_error <= 1e-9 ? 0 : 1;
+}
+
+// Квадратные размеры от 256 до max_size: время блочного gemm и Штрассена, первый размер, где Штрассен быстрее
+void find_crossover(int max_size, int cutoff, int task_depth) {
+    std::cout << "Size  Blocked(s)  Strassen(s)  Max rel. error\n";
+    int crossover = 0;
+    for (int size = 256; size <= max_size; size += size / 2) {
+        Matrix A, B, C_blk, C_str;
+        initialize_matrix(A, size, size);
+        initialize_matrix(B, size, size);
+        initialize_matrix(C_blk, size, size);
+        initialize_matrix(C_str, size, size);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        multiply_blocked(A, B, C_blk);
+        double blk_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+        start = std::chrono::high_resolution_clock::now();
+        multiply_strassen(A, B, C_str, cutoff, task_depth);
+        double str_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+        std::cout << size << "  " << blk_time << "  " << str_time << "  " << max_relative_error(C_blk, C_str) << "\n";
+        if (str_time < blk_time && crossover == 0) crossover = size;
+        if (str_time >= blk_time) crossover = 0;
+    }
+    if (crossover) {
+        std::cout << "Crossover size: " << crossover << " (Strassen faster from here up to " << max_size << ")\n";
+    } else {
+        std::cout << "Crossover size: not reached up to " << max_size << "\n";
+    }
+}
+
+int main(int argc, char** argv) {
+    int m = M, n = N, p = P;
+    int cutoff = STRASSEN_CUTOFF;
+    int task_depth = default_task_depth();
+    int crossover_max = 0;
+    int panel = OOC_PANEL;
+    bool strassen = false, tune = false;
+    std::string precision, path_a, path_b, path_c;
+    tune_cache.path = default_tune_path("matrix_multiply_openmp");
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--m" && has_value) {
+            m = std::atoi(argv[++i]);
+        } else if (arg == "--n" && has_value) {
+            n = std::atoi(argv[++i]);
+        } else if (arg == "--p" && has_value) {
+            p = std::atoi(argv[++i]);
+        } else if (arg == "--strassen") {
+            strassen = true;
+        } else if (arg == "--cutoff" && has_value) {
+            cutoff = std::atoi(argv[++i]);
+        } else if (arg == "--task-depth" && has_value) {
+            task_depth = std::atoi(argv[++i]);
+        } else if (arg == "--crossover" && has_value) {
+            crossover_max = std::atoi(argv[++i]);
+        } else if (arg == "--precision" && has_value) {
+            precision = argv[++i];
+        } else if (arg == "--a" && has_value) {
+            path_a = argv[++i];
+        } else if (arg == "--b" && has_value) {
+            path_b = argv[++i];
+        } else if (arg == "--c" && has_value) {
+            path_c = argv[++i];
+        } else if (arg == "--panel" && has_value) {
+            panel = std::atoi(argv[++i]);
+        } else if (arg == "--tune") {
+            tune = true;
+        } else if (arg == "--tune-file" && has_value) {
+            tune_cache.path = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--m ROWS_A] [--n COLS_A] [--p COLS_B]\n"
+                      << "       [--strassen] [--cutoff N] [--task-depth D] [--crossover MAX_SIZE]\n"
+                      << "       [--precision double|float|bf16|int8|all]\n"
+                      << "       [--a A.bin --b B.bin --c C.bin [--panel ROWS]] (out-of-core)\n"
+                      << "       [--tune] [--tune-file FILE]\n";
+            return 1;
+        }
+    }
+    if (!precision.empty() && precision != "double" && precision != "float" && precision != "bf16"
+        && precision != "int8" && precision != "all") {
+        std::cerr << "Unknown precision: " << precision << "\n";
+        return 1;
+    }
+    if (m < 1 || n < 1 || p < 1 || cutoff < 1 || task_depth < 0 || panel < 1) {
+        std::cerr << "Matrix dimensions, cutoff and panel must be positive\n";
+        return 1;
+    }
+    bool out_of_core = !path_a.empty() || !path_b.empty() || !path_c.empty();
+    if (out_of_core && (path_a.empty() || path_b.empty() || path_c.empty())) {
+        std::cerr << "Out-of-core mode needs --a, --b and --c\n";
+        return 1;
+    }
+
+    std::string kernel_name;
+    microkernel = select_microkernel(kernel_name);
+    // Рабочие запуски берут подобранные настройки из файла машины и не тюнят заново
+    if (tune_cache.load()) {
+        std::cout << "Loaded " << tune_cache.size() << " tuned configurations from " << tune_cache.path << "\n";
+    }
+    if (out_of_core) {
+        std::cout << "Microkernel: " << kernel_name << ", threads: " << omp_get_max_threads() << "\n";
+        return run_out_of_core(path_a, path_b, path_c, m, n, p, panel);
+    }
+    std::cout << "A: " << m << "x" << n << ", B: " << n << "x" << p << ", microkernel: " << kernel_name
+              << ", threads: " << omp_get_max_threads() << "\n";
+
+    if (crossover_max > 0) {
+        find_crossover(crossover_max, cutoff, task_depth);
+        return 0;
+    }
+
+    Matrix A, B, C_seq, C_par, C_blk;
+
+    initialize_matrix(A, m, n);
+    initialize_matrix(B, n, p);
+    initialize_matrix(C_seq, m, p);
+    initialize_matrix(C_par, m, p);
+    initialize_matrix(C_blk, m, p);
+
+    // Тюнинг для корзины текущего размера: результаты дописываются в файл машины
+    if (tune) {
+        int size = std::max(m, p);
+        TuneConfig best = autotune("parallel", tune_cache.lookup("parallel", size, parallel_defaults()), {},
+                                   [&](const TuneConfig& config) { multiply_parallel(A, B, C_par, config); });
+        tune_cache.store("parallel", size, best);
+        TuneSpace blocked_space;
+        blocked_space.tiles = { MR * 8, MR * 16, MR * 32, MR * 64 };
+        best = autotune("blocked", tune_cache.lookup("blocked", size, blocked_defaults()), blocked_space,
+                        [&](const TuneConfig& config) { multiply_blocked(A, B, C_blk, config); });
+        tune_cache.store("blocked", size, best);
+        if (!tune_cache.save()) {
+            std::cerr << "Failed to write " << tune_cache.path << "\n";
+            return 1;
+        }
+        std::cout << "Saved tuning for size bucket " << size_bucket(size) << " to " << tune_cache.path << "\n";
+    }
 
     auto start_seq = std::chrono::high_resolution_clock::now();
     multiply_sequential(A, B, C_seq);
     auto end_seq = std::chrono::high_resolution_clock::now();
     double seq_time = std::chrono::duration<double>(end_seq - start_seq).count();
-    std::cout << "Sequential multiplication time: " << seq_time << " seconds\n";
+    std::cout << "Sequential multiplication time: " << seq_time << " seconds ("
+              << gflops(m, n, p, seq_time) << " GFLOP/s)\n";
 
     auto start_par = std::chrono::high_resolution_clock::now();
     multiply_parallel(A, B, C_par);
     auto end_par = std::chrono::high_resolution_clock::now();
     double par_time = std::chrono::duration<double>(end_par - start_par).count();
-    std::cout << "Parallel multiplication time: " << par_time << " seconds\n";
-
-    bool correct = true;
-    for (int i = 0; i < M; ++i) {
-        for (int j = 0; j < P; ++j) {
-            if (std::abs(C_seq[i][j] - C_par[i][j]) > 1e-6) {
-                correct = false;
-                break;
-            }
-        }
+    std::cout << "Parallel multiplication time: " << par_time << " seconds ("
+              << gflops(m, n, p, par_time) << " GFLOP/s)\n";
+
+    auto start_blk = std::chrono::high_resolution_clock::now();
+    multiply_blocked(A, B, C_blk);
+    auto end_blk = std::chrono::high_resolution_clock::now();
+    double blk_time = std::chrono::duration<double>(end_blk - start_blk).count();
+    std::cout << "Blocked multiplication time: " << blk_time << " seconds ("
+              << gflops(m, n, p, blk_time) << " GFLOP/s)\n";
+
+    std::cout << "Results match: " << (results_match(C_seq, C_par) ? "Yes" : "No") << "\n";
+    std::cout << "Blocked results match: " << (results_match(C_seq, C_blk) ? "Yes" : "No") << "\n";
+
+    if (strassen) {
+        Matrix C_str;
+        initialize_matrix(C_str, m, p);
+        auto start_str = std::chrono::high_resolution_clock::now();
+        size_t arena_bytes = multiply_strassen(A, B, C_str, cutoff, task_depth);
+        auto end_str = std::chrono::high_resolution_clock::now();
+        double str_time = std::chrono::duration<double>(end_str - start_str).count();
+        std::cout << "Strassen multiplication time (cutoff " << cutoff << ", task depth " << task_depth << "): "
+                  << str_time << " seconds (" << gflops(m, n, p, str_time) << " effective GFLOP/s), arena "
+                  << arena_bytes / (1024.0 * 1024.0) << " MB\n";
+        std::cout << "Strassen max relative error vs classical: " << max_relative_error(C_blk, C_str) << "\n";
+    }
+
+    if (!precision.empty()) {
+        select_dot_kernels();
+        std::cout << "Typed kernels (" << (use_avx2 ? "avx2" : "scalar") << "), error against the blocked double product:\n";
+        bool all = precision == "all";
+        if (all || precision == "double") run_precision<double, double>("double", A, B, C_blk);
+        if (all || precision == "float") run_precision<float, float>("float", A, B, C_blk);
+        if (all || precision == "bf16") run_precision<bf16, float>("bf16/float", A, B, C_blk);
+        if (all || precision == "int8") run_precision<int8_t, int32_t>("int8/int32", A, B, C_blk);
     }
-    std::cout << "Results match: " << (correct ? "Yes" : "No") << "\n";
 
     return 0;
-}
\ No newline at end of file
+}
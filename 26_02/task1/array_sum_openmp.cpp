@@ -2,13 +2,35 @@
 #include <vector>
 #include <random>
 #include <chrono>
+#include <string>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include <unistd.h>
 #include <omp.h>
+#include "../../common/deterministic_sum.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define SIMD_KERNELS 1
+#else
+#define SIMD_KERNELS 0
+#endif
 
 #define SIZE 10000000
 
-void initialize_array(std::vector<double>& arr) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
+// Потоковая сумма: восемь независимых векторных аккумуляторов скрывают задержку сложения,
+// предвыборка идёт на PREFETCH_DISTANCE элементов вперёд
+#define PREFETCH_DISTANCE 256
+// Развёртка по размеру: от SWEEP_MIN_BYTES вдвое до 4 x LLC (не меньше SWEEP_MIN_MAX_BYTES и не больше SWEEP_MAX_BYTES),
+// на каждый размер ~SWEEP_BYTES чтения
+#define SWEEP_MIN_BYTES 4096
+#define SWEEP_MIN_MAX_BYTES (256LL << 20)
+#define SWEEP_MAX_BYTES (4LL << 30)
+#define SWEEP_BYTES (1LL << 30)
+
+void initialize_array(std::vector<double>& arr, unsigned seed) {
+    std::mt19937 gen(seed);
     std::uniform_real_distribution<> dis(0.0, 10.0);
     arr.resize(SIZE);
     for (int i = 0; i < SIZE; ++i) {
@@ -33,9 +55,197 @@ double sum_parallel(const std::vector<double>& arr) {
     return sum;
 }
 
-int main() {
+// Скалярный вариант: восемь цепочек вместо одной
+double reduce_scalar(const double* data, size_t count) {
+    double acc[8] = {};
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        for (int l = 0; l < 8; ++l) acc[l] += data[i + l];
+    }
+    for (; i < count; ++i) acc[0] += data[i];
+    return ((acc[0] + acc[1]) + (acc[2] + acc[3])) + ((acc[4] + acc[5]) + (acc[6] + acc[7]));
+}
+
+#if SIMD_KERNELS
+__attribute__((target("avx2")))
+double reduce_avx2(const double* data, size_t count) {
+    __m256d acc[8];
+    for (int l = 0; l < 8; ++l) acc[l] = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        // 32 double - четыре строки кэша по 64 байта, на каждую своя предвыборка
+        for (int line = 0; line < 4; ++line) {
+            _mm_prefetch((const char*)(data + i + PREFETCH_DISTANCE + 8 * line), _MM_HINT_T0);
+        }
+        for (int l = 0; l < 8; ++l) acc[l] = _mm256_add_pd(acc[l], _mm256_loadu_pd(data + i + 4 * l));
+    }
+    for (int l = 1; l < 8; ++l) acc[0] = _mm256_add_pd(acc[0], acc[l]);
+    double lanes[4];
+    _mm256_storeu_pd(lanes, acc[0]);
+    double sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    for (; i < count; ++i) sum += data[i];
+    return sum;
+}
+
+__attribute__((target("avx512f")))
+double reduce_avx512(const double* data, size_t count) {
+    __m512d acc[8];
+    for (int l = 0; l < 8; ++l) acc[l] = _mm512_setzero_pd();
+    size_t i = 0;
+    for (; i + 64 <= count; i += 64) {
+        for (int line = 0; line < 8; ++line) {
+            _mm_prefetch((const char*)(data + i + PREFETCH_DISTANCE + 8 * line), _MM_HINT_T0);
+        }
+        for (int l = 0; l < 8; ++l) acc[l] = _mm512_add_pd(acc[l], _mm512_loadu_pd(data + i + 8 * l));
+    }
+    for (int l = 1; l < 8; ++l) acc[0] = _mm512_add_pd(acc[0], acc[l]);
+    double lanes[8];
+    _mm512_storeu_pd(lanes, acc[0]);
+    double sum = ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+    for (; i < count; ++i) sum += data[i];
+    return sum;
+}
+#endif
+
+typedef double (*ReduceKernel)(const double*, size_t);
+ReduceKernel reduce_kernel = reduce_scalar;
+
+// auto - лучшее, что поддерживает процессор; явно выбранное неподдерживаемое ядро заменяется скалярным
+const char* select_reduce_kernel(const std::string& requested) {
+    reduce_kernel = reduce_scalar;
+#if SIMD_KERNELS
+    bool avx512 = __builtin_cpu_supports("avx512f"), avx2 = __builtin_cpu_supports("avx2");
+    if ((requested == "auto" || requested == "avx512") && avx512) {
+        reduce_kernel = reduce_avx512;
+        return "avx512";
+    }
+    if ((requested == "auto" || requested == "avx2") && avx2) {
+        reduce_kernel = reduce_avx2;
+        return "avx2";
+    }
+#endif
+    return "scalar";
+}
+
+// Сумма любого непрерывного участка памяти в текущем потоке
+double reduce(const double* data, size_t count) {
+    return reduce_kernel(data, count);
+}
+
+template<typename Container>
+double reduce(const Container& values) {
+    return reduce(values.data(), values.size());
+}
+
+// Участок делится на непрерывные куски по потокам (границы кратны 8 элементам - строке кэша)
+double reduce_parallel(const double* data, size_t count, int threads) {
+    double sum = 0.0;
+    #pragma omp parallel num_threads(threads) reduction(+:sum)
+    {
+        int parts = omp_get_num_threads(), t = omp_get_thread_num();
+        size_t per_thread = (count / parts + 7) / 8 * 8;
+        size_t first = std::min(count, per_thread * t);
+        size_t last = t == parts - 1 ? count : std::min(count, first + per_thread);
+        sum += reduce(data + first, last - first);
+    }
+    return sum;
+}
+
+// Развёртка по размеру массива: ГБ/с одного потока и всех потоков; уровень - первый кэш, куда массив помещается
+// (L1 и L2 - на ядро, L3 - общий). Итог по уровню - медиана размеров, попавших в него
+void run_sweep(int threads) {
+    long long caches[3] = { sysconf(_SC_LEVEL1_DCACHE_SIZE), sysconf(_SC_LEVEL2_CACHE_SIZE), sysconf(_SC_LEVEL3_CACHE_SIZE) };
+    const char* names[4] = { "L1", "L2", "L3", "DRAM" };
+    long long llc = std::max({ caches[0], caches[1], caches[2], 0LL });
+    long long max_bytes = std::min(SWEEP_MAX_BYTES, std::max(SWEEP_MIN_MAX_BYTES, 4 * llc));
+    std::cout << "Caches: L1 " << caches[0] / 1024 << " KB, L2 " << caches[1] / 1024 << " KB, L3 "
+              << caches[2] / 1024 << " KB; " << threads << " threads\n";
+
+    size_t max_count = (size_t)(max_bytes / sizeof(double));
+    std::vector<double> data(max_count);
+    #pragma omp parallel for schedule(static) num_threads(threads)
+    for (size_t i = 0; i < max_count; ++i) data[i] = (double)(i % 1000) * 0.001;
+
+    // Один поток зовёт reduce напрямую, чтобы на малых размерах не мерить запуск параллельной области
+    auto measure = [&](size_t count, int t) {
+        long long repeats = std::max(3LL, SWEEP_BYTES / (long long)(count * sizeof(double)));
+        volatile double sink = 0.0;
+        auto run = [&] { return t == 1 ? reduce(data.data(), count) : reduce_parallel(data.data(), count, t); };
+        sink = sink + run();
+        auto start = std::chrono::high_resolution_clock::now();
+        for (long long r = 0; r < repeats; ++r) sink = sink + run();
+        double time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+        return (double)repeats * count * sizeof(double) / time / 1e9;
+    };
+
+    std::cout << "Bytes  Level  1 thread (GB/s)  " << threads << " threads (GB/s)\n";
+    std::vector<double> level_single[4], level_all[4];
+    for (long long bytes = SWEEP_MIN_BYTES; bytes <= max_bytes; bytes *= 2) {
+        int level = 0;
+        while (level < 3 && (caches[level] <= 0 || bytes > caches[level])) level++;
+        double single = measure((size_t)(bytes / sizeof(double)), 1);
+        double all = threads > 1 ? measure((size_t)(bytes / sizeof(double)), threads) : single;
+        level_single[level].push_back(single);
+        level_all[level].push_back(all);
+        std::cout << bytes << "  " << names[level] << "  " << single << "  " << all << "\n";
+    }
+    auto median = [](std::vector<double> values) {
+        std::sort(values.begin(), values.end());
+        return values[values.size() / 2];
+    };
+    for (int level = 0; level < 4; ++level) {
+        if (!level_single[level].empty()) {
+            std::cout << names[level] << ": " << median(level_single[level]) << " GB/s (1 thread), "
+                      << median(level_all[level]) << " GB/s (" << threads << " threads)\n";
+        }
+    }
+}
+
+// Результат побитово одинаков при любом числе потоков: потоки лишь делят между собой блоки
+double sum_deterministic(const std::vector<double>& arr, int threads) {
+    int size = (int)arr.size();
+    int blocks = (size + DET_BLOCK - 1) / DET_BLOCK;
+    std::vector<CompensatedSum> parts(blocks);
+    #pragma omp parallel for schedule(static) num_threads(threads)
+    for (int b = 0; b < blocks; ++b) {
+        int first = b * DET_BLOCK;
+        parts[b] = block_sum(&arr[first], std::min(DET_BLOCK, size - first));
+    }
+    CompensatedSum total = tree_reduce(parts);
+    return total.sum + total.error;
+}
+
+int main(int argc, char** argv) {
+    unsigned seed = std::random_device()();
+    std::string kernel = "auto";
+    bool sweep = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--seed" && has_value) {
+            seed = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--kernel" && has_value) {
+            kernel = argv[++i];
+        } else if (arg == "--sweep") {
+            sweep = true;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--seed N] [--kernel auto|avx512|avx2|scalar] [--sweep]\n";
+            return 1;
+        }
+    }
+    if (kernel != "auto" && kernel != "avx512" && kernel != "avx2" && kernel != "scalar") {
+        std::cerr << "Unknown kernel: " << kernel << "\n";
+        return 1;
+    }
+    const char* kernel_name = select_reduce_kernel(kernel);
+    if (sweep) {
+        std::cout << "Reduce kernel: " << kernel_name << "\n";
+        run_sweep(omp_get_max_threads());
+        return 0;
+    }
+
     std::vector<double> arr;
-    initialize_array(arr);
+    initialize_array(arr, seed);
 
     auto start_seq = std::chrono::high_resolution_clock::now();
     double seq_sum = sum_sequential(arr);
@@ -51,7 +261,37 @@ int main() {
     std::cout << "Parallel sum: " << par_sum << "\n";
     std::cout << "Parallel time: " << par_time << " seconds\n";
 
-    std::cout << "Results match: " << (std::abs(seq_sum - par_sum) < 1e-6 ? "Yes" : "No") << "\n";
+    // Ошибка округления обычной суммы растёт с длиной массива, поэтому допуск относительный
+    std::cout << "Results match: " << (std::abs(seq_sum - par_sum) <= 1e-10 * std::abs(seq_sum) ? "Yes" : "No") << "\n";
 
-    return 0;
-}
\ No newline at end of file
+    double bytes = (double)SIZE * sizeof(double);
+    auto start_simd = std::chrono::high_resolution_clock::now();
+    double simd_sum = reduce_parallel(arr.data(), arr.size(), omp_get_max_threads());
+    auto end_simd = std::chrono::high_resolution_clock::now();
+    double simd_time = std::chrono::duration<double>(end_simd - start_simd).count();
+    std::cout << "SIMD sum (" << kernel_name << "): " << simd_sum << "\n";
+    std::cout << "SIMD time: " << simd_time << " seconds (" << bytes / simd_time / 1e9 << " GB/s, plain reduction "
+              << bytes / par_time / 1e9 << " GB/s)\n";
+    std::cout << "SIMD results match: " << (std::abs(seq_sum - simd_sum) <= 1e-10 * std::abs(seq_sum) ? "Yes" : "No") << "\n";
+
+    int threads = omp_get_max_threads();
+    auto start_det = std::chrono::high_resolution_clock::now();
+    double det_sum = sum_deterministic(arr, threads);
+    auto end_det = std::chrono::high_resolution_clock::now();
+    double det_time = std::chrono::duration<double>(end_det - start_det).count();
+    std::cout.precision(17);
+    std::cout << "Deterministic sum: " << det_sum << " (" << std::hexfloat << det_sum << std::defaultfloat << ")\n";
+    std::cout.precision(6);
+    std::cout << "Deterministic time: " << det_time << " seconds (" << det_time / par_time << "x the plain reduction)\n";
+    std::cout << "Plain reductions differ from it by: sequential " << std::abs(seq_sum - det_sum)
+              << ", parallel " << std::abs(par_sum - det_sum) << "\n";
+
+    // Та же сумма на любом числе потоков от 1 до 2 x threads должна совпасть побитово
+    bool identical = true;
+    for (int t = 1; t <= 2 * threads; ++t) {
+        identical = identical && sum_deterministic(arr, t) == det_sum;
+    }
+    std::cout << "Bit-identical for 1.." << 2 * threads << " threads: " << (identical ? "Yes" : "No") << "\n";
+
+    return identical ? 0 : 1;
+}
@@ -2,53 +2,197 @@
 #include <iostream>
 #include <cmath>
 #include <chrono>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
 #include <omp.h>
+#include "integration.h"
 
-#define A (-M_PI)
-#define B M_PI
-#define N 1000000
+#define ABS_TOL 1e-10
+#define MIDPOINT_MAX_N (1LL << 30)
+#define DEFAULT_N 1000000
+#define BATCH_REPEAT 5
 
-double f(double x) {
-    return std::exp(-x * x);
-}
+// exp(-x^2): пакетный вызов считает блок через векторизованную exp
+struct Gaussian {
+    double operator()(double x) const { return std::exp(-x * x); }
+    void batch(const double* x, double* y) const {
+        double t[INTEGRAND_BATCH];
+        for (int j = 0; j < INTEGRAND_BATCH; ++j) t[j] = -x[j] * x[j];
+        exp_batch(t, y);
+    }
+    double exact(double a, double b) const { return std::sqrt(M_PI) / 2 * (std::erf(b) - std::erf(a)); }
+};
 
-double integrate_sequential() {
-    double dx = (B - A) / N;
-    double sum = 0.0;
-    for (int i = 0; i < N; ++i) {
-        double x = A + (i + 0.5) * dx;
-        sum += f(x);
+// x^2 exp(-x^2)
+struct SecondMoment {
+    double operator()(double x) const { return x * x * std::exp(-x * x); }
+    void batch(const double* x, double* y) const {
+        double t[INTEGRAND_BATCH];
+        for (int j = 0; j < INTEGRAND_BATCH; ++j) t[j] = -x[j] * x[j];
+        exp_batch(t, y);
+        for (int j = 0; j < INTEGRAND_BATCH; ++j) y[j] *= x[j] * x[j];
+    }
+    double exact(double a, double b) const {
+        auto primitive = [](double x) { return std::sqrt(M_PI) / 4 * std::erf(x) - x * std::exp(-x * x) / 2; };
+        return primitive(b) - primitive(a);
     }
-    return sum * dx;
+};
+
+double seconds_since(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
 }
 
-double integrate_parallel() {
-    double dx = (B - A) / N;
-    double sum = 0.0;
-    #pragma omp parallel for reduction(+:sum)
-    for (int i = 0; i < N; ++i) {
-        double x = A + (i + 0.5) * dx;
-        sum += f(x);
+int main(int argc, char** argv) {
+    double a = -M_PI, b = M_PI;
+    long long n = DEFAULT_N;
+    double abs_tol = ABS_TOL, rel_tol = 0.0;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--a" && has_value) {
+            a = std::atof(argv[++i]);
+        } else if (arg == "--b" && has_value) {
+            b = std::atof(argv[++i]);
+        } else if (arg == "--n" && has_value) {
+            n = std::atoll(argv[++i]);
+        } else if (arg == "--tol" && has_value) {
+            abs_tol = std::atof(argv[++i]);
+        } else if (arg == "--rel" && has_value) {
+            rel_tol = std::atof(argv[++i]);
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--a LOWER] [--b UPPER] [--n NODES] [--tol ABS_ERROR] [--rel REL_ERROR]\n";
+            return 1;
+        }
     }
-    return sum * dx;
-}
+    if (n < 1 || !(a < b)) {
+        std::cerr << "Need a < b and at least one node\n";
+        return 1;
+    }
+    if (abs_tol <= 0.0 && rel_tol <= 0.0) {
+        std::cerr << "Error target must be positive\n";
+        return 1;
+    }
+
+    Gaussian gaussian;
+    SecondMoment moment;
+    auto rational = [](double x) { return 1.0 / (1.0 + x * x); };
+    auto gaussian_scalar = [](double x) { return std::exp(-x * x); };
+    double exact = gaussian.exact(a, b);
 
-int main() {
     auto start_seq = std::chrono::high_resolution_clock::now();
-    double seq_result = integrate_sequential();
-    auto end_seq = std::chrono::high_resolution_clock::now();
-    double seq_time = std::chrono::duration<double>(end_seq - start_seq).count();
+    double seq_result = integrate_midpoint_sequential(gaussian_scalar, a, b, n);
+    double seq_time = seconds_since(start_seq);
     std::cout << "Sequential integral: " << seq_result << "\n";
     std::cout << "Sequential time: " << seq_time << " seconds\n";
 
     auto start_par = std::chrono::high_resolution_clock::now();
-    double par_result = integrate_parallel();
-    auto end_par = std::chrono::high_resolution_clock::now();
-    double par_time = std::chrono::duration<double>(end_par - start_par).count();
+    double par_result = integrate_midpoint(gaussian, a, b, n);
+    double par_time = seconds_since(start_par);
     std::cout << "Parallel integral: " << par_result << "\n";
     std::cout << "Parallel time: " << par_time << " seconds\n";
 
     std::cout << "Results match: " << (std::abs(seq_result - par_result) < 1e-6 ? "Yes" : "No") << "\n";
 
+    // Та же функция лямбдой без пакетного вызова - поточечный std::exp; из BATCH_REPEAT замеров берётся меньший
+    double batch_time = 1e30, scalar_time = 1e30, scalar_result = 0.0;
+    for (int r = 0; r < BATCH_REPEAT; r++) {
+        auto start_batch = std::chrono::high_resolution_clock::now();
+        integrate_midpoint(gaussian, a, b, n);
+        batch_time = std::min(batch_time, seconds_since(start_batch));
+        auto start_scalar = std::chrono::high_resolution_clock::now();
+        scalar_result = integrate_midpoint(gaussian_scalar, a, b, n);
+        scalar_time = std::min(scalar_time, seconds_since(start_scalar));
+    }
+    std::cout << "Batch time: " << batch_time << " seconds, without batch " << scalar_time << " seconds, speedup "
+              << scalar_time / batch_time << "x\n";
+    std::cout << "Batch results match: " << (std::abs(scalar_result - par_result) < 1e-12 ? "Yes" : "No") << "\n";
+
+    double max_exp_error = 0.0;
+    for (int i = 0; i < 100000; i += INTEGRAND_BATCH) {
+        double x[INTEGRAND_BATCH], y[INTEGRAND_BATCH];
+        for (int j = 0; j < INTEGRAND_BATCH; ++j) x[j] = -700.0 + 1400.0 * (i + j) / 100000;
+        exp_batch(x, y);
+        for (int j = 0; j < INTEGRAND_BATCH; ++j) {
+            max_exp_error = std::max(max_exp_error, std::abs(y[j] - std::exp(x[j])) / std::exp(x[j]));
+        }
+    }
+    // Края: денормализованные значения, ноль, переполнение и аргументы, далеко выходящие за диапазон порядка
+    const double edges[] = { -INFINITY, -1e300, -1e15, -1e12, -2e9, -1.5e9, -1e5, -746.0, -745.1, -744.0, -720.0,
+                             -708.5, 709.5, 709.78, 709.8, 710.0, 1e5, 1e300, INFINITY, 0.0, -0.0 };
+    const int edge_count = sizeof(edges) / sizeof(edges[0]);
+    bool edges_match = true;
+    for (int i = 0; i < edge_count; i += INTEGRAND_BATCH) {
+        double x[INTEGRAND_BATCH], y[INTEGRAND_BATCH];
+        for (int j = 0; j < INTEGRAND_BATCH; ++j) x[j] = edges[std::min(i + j, edge_count - 1)];
+        exp_batch(x, y);
+        for (int j = 0; j < INTEGRAND_BATCH; ++j) {
+            double expected = std::exp(x[j]);
+            bool close = std::isfinite(expected) && expected > 0.0
+                ? std::abs(y[j] - expected) <= 1e-15 * expected + 4.94e-324 : y[j] == expected;
+            edges_match = edges_match && close;
+        }
+    }
+    double nan_in[INTEGRAND_BATCH], nan_out[INTEGRAND_BATCH];
+    std::fill(nan_in, nan_in + INTEGRAND_BATCH, NAN);
+    exp_batch(nan_in, nan_out);
+    edges_match = edges_match && std::isnan(nan_out[0]);
+    std::cout << "Vectorized exp max relative error: " << max_exp_error << ", edge values match std::exp: "
+              << (edges_match ? "Yes" : "No") << "\n";
+
+    // Три функции за один проход по общим узлам против трёх отдельных проходов
+    std::array<double, 3> sweep;
+    double separate[3];
+    double sweep_time = 1e30, separate_time = 1e30;
+    for (int r = 0; r < BATCH_REPEAT; r++) {
+        auto start_sweep = std::chrono::high_resolution_clock::now();
+        sweep = integrate_midpoint_many(a, b, n, gaussian, moment, rational);
+        sweep_time = std::min(sweep_time, seconds_since(start_sweep));
+        auto start_separate = std::chrono::high_resolution_clock::now();
+        separate[0] = integrate_midpoint(gaussian, a, b, n);
+        separate[1] = integrate_midpoint(moment, a, b, n);
+        separate[2] = integrate_midpoint(rational, a, b, n);
+        separate_time = std::min(separate_time, seconds_since(start_separate));
+    }
+    double exact_sweep[3] = { exact, moment.exact(a, b), std::atan(b) - std::atan(a) };
+    const char* names[3] = { "exp(-x^2)", "x^2 exp(-x^2)", "1/(1+x^2)" };
+    bool sweep_match = true;
+    for (int k = 0; k < 3; ++k) {
+        std::cout << "Sweep " << names[k] << ": " << sweep[k] << ", error " << std::abs(sweep[k] - exact_sweep[k]) << "\n";
+        sweep_match = sweep_match && std::abs(sweep[k] - separate[k]) <= 1e-12 * std::abs(separate[k]);
+    }
+    std::cout << "Sweep time: " << sweep_time << " seconds, separate passes " << separate_time << " seconds\n";
+    std::cout << "Sweep results match: " << (sweep_match ? "Yes" : "No") << "\n";
+
+    auto start_adp = std::chrono::high_resolution_clock::now();
+    QuadResult adaptive = integrate_adaptive(gaussian, a, b, abs_tol, rel_tol);
+    double adp_time = seconds_since(start_adp);
+    double target = std::max(abs_tol, rel_tol * std::abs(exact));
+    std::cout.precision(15);
+    std::cout << "Adaptive integral: " << adaptive.value << "\n";
+    std::cout.precision(6);
+    if (!adaptive.converged) {
+        std::cout << "Adaptive refinement stopped: evaluation limit, depth limit or non-finite error estimate\n";
+    }
+    std::cout << "Adaptive time: " << adp_time << " seconds, " << adaptive.evaluations << " evaluations, estimated error "
+              << adaptive.error << ", actual error " << std::abs(adaptive.value - exact) << " (target " << target << ")\n";
+
+    // Правило средних точек с удвоением числа узлов до той же точности
+    long long mid_n = 1000;
+    double mid_result = integrate_midpoint(gaussian, a, b, mid_n);
+    while (std::abs(mid_result - exact) > target && mid_n <= MIDPOINT_MAX_N / 2) {
+        mid_n *= 2;
+        mid_result = integrate_midpoint(gaussian, a, b, mid_n);
+    }
+    auto start_mid = std::chrono::high_resolution_clock::now();
+    mid_result = integrate_midpoint(gaussian, a, b, mid_n);
+    double mid_time = seconds_since(start_mid);
+    bool reached = std::abs(mid_result - exact) <= target;
+    std::cout << "Midpoint rule at the same accuracy: " << (reached ? "" : "not reached, ") << mid_n << " evaluations, "
+              << mid_time << " seconds, actual error " << std::abs(mid_result - exact) << "\n";
+    std::cout << "Adaptive vs midpoint: " << (double)mid_n / adaptive.evaluations << "x fewer evaluations, "
+              << mid_time / adp_time << "x faster\n";
+    std::cout << "Adaptive results match: " << (std::abs(adaptive.value - exact) <= target ? "Yes" : "No") << "\n";
+
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,446 @@
+#define _USE_MATH_DEFINES // Добавляем для M_PI
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <string>
+#include <cmath>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include <omp.h>
+#include <mpi.h>
+
+// Многомерный интеграл по единичному кубу методом Монте-Карло (Philox) и квази-Монте-Карло (Соболь со скремблированием).
+// Точка с номером i вычисляется из seed и i без общего состояния генератора: поток и ранг берут свой отрезок номеров,
+// и набор точек не зависит от числа потоков и процессов
+#define MAX_DIM 20
+#define DEFAULT_DIM 10
+#define SOBOL_BITS 32
+// Точки раздаются потокам порциями; на входе в порцию точка Соболя строится заново, дальше - по коду Грея
+#define POINT_CHUNK 4096
+// Раунды удваивают число точек; после каждого раунда - сборка статистики и проверка стандартной ошибки
+#define FIRST_ROUND (1LL << 12)
+#define DEFAULT_MAX_POINTS (1LL << 28)
+#define DEFAULT_REPLICATES 16
+#define DEFAULT_TARGET 1e-3
+#define SCALING_POINTS (1LL << 20)
+
+// SplitMix64: ключи Philox и параметры скремблирования из seed
+static inline uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Philox4x32-10 (Salmon и др., 2011): счётчик из четырёх слов шифруется ключом из двух слов за 10 раундов
+static inline void philox4x32(uint32_t c[4], uint32_t k0, uint32_t k1) {
+    for (int round = 0; round < 10; ++round) {
+        if (round > 0) {
+            k0 += 0x9E3779B9u;
+            k1 += 0xBB67AE85u;
+        }
+        uint64_t p0 = (uint64_t)0xD2511F53u * c[0];
+        uint64_t p1 = (uint64_t)0xCD9E8D57u * c[2];
+        uint32_t n0 = (uint32_t)(p1 >> 32) ^ c[1] ^ k0;
+        uint32_t n2 = (uint32_t)(p0 >> 32) ^ c[3] ^ k1;
+        c[0] = n0;
+        c[1] = (uint32_t)p1;
+        c[2] = n2;
+        c[3] = (uint32_t)p0;
+    }
+}
+
+// 53 случайных бита из двух слов
+static inline double to_unit(uint32_t high, uint32_t low) {
+    return ((high >> 5) * 67108864.0 + (low >> 6)) * (1.0 / 9007199254740992.0);
+}
+
+// Точка i для Монте-Карло: счётчик (i, номер пары координат), ключ - seed; одна шифровка даёт две координаты
+static inline void philox_point(uint64_t seed, uint64_t index, int dim, double* x) {
+    for (int pair = 0; 2 * pair < dim; ++pair) {
+        uint32_t c[4] = { (uint32_t)index, (uint32_t)(index >> 32), (uint32_t)pair, 0 };
+        philox4x32(c, (uint32_t)seed, (uint32_t)(seed >> 32));
+        x[2 * pair] = to_unit(c[0], c[1]);
+        if (2 * pair + 1 < dim) x[2 * pair + 1] = to_unit(c[2], c[3]);
+    }
+}
+
+// Начальные числа направлений Соболя (Joe, Kuo: new-joe-kuo-6.21201) для измерений 2..MAX_DIM:
+// степень s примитивного многочлена, его коэффициенты a и первые s чисел m
+struct SobolInit {
+    int s, a;
+    uint32_t m[7];
+};
+static const SobolInit SOBOL_INIT[MAX_DIM - 1] = {
+    { 1, 0, { 1 } },
+    { 2, 1, { 1, 3 } },
+    { 3, 1, { 1, 3, 1 } },
+    { 3, 2, { 1, 1, 1 } },
+    { 4, 1, { 1, 1, 3, 3 } },
+    { 4, 4, { 1, 3, 5, 13 } },
+    { 5, 2, { 1, 1, 5, 5, 17 } },
+    { 5, 4, { 1, 1, 5, 5, 5 } },
+    { 5, 7, { 1, 1, 7, 11, 19 } },
+    { 5, 11, { 1, 1, 5, 1, 1 } },
+    { 5, 13, { 1, 1, 1, 3, 11 } },
+    { 5, 14, { 1, 3, 5, 5, 31 } },
+    { 6, 1, { 1, 3, 3, 9, 7, 49 } },
+    { 6, 13, { 1, 1, 1, 15, 21, 21 } },
+    { 6, 16, { 1, 3, 1, 13, 27, 49 } },
+    { 6, 19, { 1, 1, 1, 15, 7, 5 } },
+    { 6, 22, { 1, 3, 1, 15, 13, 25 } },
+    { 6, 25, { 1, 1, 5, 5, 19, 61 } },
+    { 7, 1, { 1, 3, 7, 11, 23, 15, 103 } },
+};
+
+// Числа направлений v[d][k] для бита k номера точки; первое измерение - ван дер Корпут
+struct Sobol {
+    uint32_t v[MAX_DIM][SOBOL_BITS];
+
+    Sobol() {
+        for (int k = 0; k < SOBOL_BITS; ++k) v[0][k] = 1u << (SOBOL_BITS - 1 - k);
+        for (int d = 1; d < MAX_DIM; ++d) {
+            const SobolInit& init = SOBOL_INIT[d - 1];
+            for (int k = 0; k < init.s; ++k) v[d][k] = init.m[k] << (SOBOL_BITS - 1 - k);
+            for (int k = init.s; k < SOBOL_BITS; ++k) {
+                v[d][k] = v[d][k - init.s] ^ (v[d][k - init.s] >> init.s);
+                for (int j = 1; j < init.s; ++j) {
+                    if ((init.a >> (init.s - 1 - j)) & 1) v[d][k] ^= v[d][k - j];
+                }
+            }
+        }
+    }
+
+    // Координата d точки с номером gray в порядке кода Грея
+    uint32_t direct(int d, uint64_t gray) const {
+        uint32_t x = 0;
+        for (int k = 0; gray; ++k, gray >>= 1) {
+            if (gray & 1) x ^= v[d][k];
+        }
+        return x;
+    }
+};
+
+static inline uint32_t reverse_bits(uint32_t x) {
+    x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+    x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+    x = ((x >> 4) & 0x0F0F0F0Fu) | ((x & 0x0F0F0F0Fu) << 4);
+    x = ((x >> 8) & 0x00FF00FFu) | ((x & 0x00FF00FFu) << 8);
+    return (x >> 16) | (x << 16);
+}
+
+// Скремблирование Оуэна хешем (Burley, 2020): старший бит координаты решает судьбу младших, а не наоборот.
+// Каждая реплика со своими seed - независимая несмещённая оценка, разброс реплик даёт стандартную ошибку
+static inline uint32_t owen_scramble(uint32_t x, uint32_t seed) {
+    x = reverse_bits(x);
+    x += seed;
+    x ^= x * 0x6C50B47Cu;
+    x ^= x * 0xB82F1E52u;
+    x ^= x * 0xC7AFE638u;
+    x ^= x * 0x8D22F6E6u;
+    return reverse_bits(x);
+}
+
+// Тестовые функции с известным интегралом по [0, 1]^dim
+// g-функция Соболя: произведение (|4x - 2| + a_j) / (1 + a_j), a_j = j; интеграл 1
+struct GFunction {
+    double operator()(const double* x, int dim) const {
+        double product = 1.0;
+        for (int j = 0; j < dim; ++j) product *= (std::abs(4.0 * x[j] - 2.0) + j) / (1.0 + j);
+        return product;
+    }
+    double exact(int) const { return 1.0; }
+};
+
+// exp(-|x|^2); интеграл (sqrt(pi) / 2 * erf(1))^dim
+struct Gaussian {
+    double operator()(const double* x, int dim) const {
+        double r2 = 0.0;
+        for (int j = 0; j < dim; ++j) r2 += x[j] * x[j];
+        return std::exp(-r2);
+    }
+    double exact(int dim) const { return std::pow(std::sqrt(M_PI) / 2 * std::erf(1.0), dim); }
+};
+
+// Текущие среднее и сумма квадратов отклонений (Уэлфорд); объединение двух частей - формула Чана
+struct RunningStats {
+    double count = 0.0;
+    double mean = 0.0;
+    double m2 = 0.0;
+
+    void add(double value) {
+        count += 1.0;
+        double delta = value - mean;
+        mean += delta / count;
+        m2 += delta * (value - mean);
+    }
+
+    void merge(const RunningStats& other) {
+        if (other.count == 0.0) return;
+        double total = count + other.count;
+        double delta = other.mean - mean;
+        mean += delta * other.count / total;
+        m2 += other.m2 + delta * delta * count * other.count / total;
+        count = total;
+    }
+
+    double variance() const { return count > 1.0 ? m2 / (count - 1.0) : 0.0; }
+};
+
+struct Estimate {
+    double value = 0.0;
+    double std_error = 0.0;
+    long long points = 0;
+    int rounds = 0;
+    double time = 0.0;
+};
+
+void block_range(long long n, int parts, int index, long long* start, long long* count) {
+    *count = n / parts + (index < n % parts);
+    *start = index * (n / parts) + (index < n % parts ? index : n % parts);
+}
+
+// Монте-Карло: точки [begin, begin + n) раунда делятся между рангами, внутри ранга - порциями между потоками.
+// Статистики потоков и рангов сливаются в фиксированном порядке
+template<typename F>
+RunningStats mc_round(const F& f, int dim, uint64_t seed, long long begin, long long n, int rank, int size) {
+    long long first, count;
+    block_range(n, size, rank, &first, &count);
+    first += begin;
+    long long chunks = (count + POINT_CHUNK - 1) / POINT_CHUNK;
+    std::vector<RunningStats> per_thread(omp_get_max_threads());
+    #pragma omp parallel
+    {
+        RunningStats local;
+        double x[MAX_DIM];
+        #pragma omp for schedule(static)
+        for (long long chunk = 0; chunk < chunks; ++chunk) {
+            long long end = std::min(count, (chunk + 1) * POINT_CHUNK);
+            for (long long i = chunk * POINT_CHUNK; i < end; ++i) {
+                philox_point(seed, (uint64_t)(first + i), dim, x);
+                local.add(f(x, dim));
+            }
+        }
+        per_thread[omp_get_thread_num()] = local;
+    }
+    RunningStats rank_stats;
+    for (const RunningStats& s : per_thread) rank_stats.merge(s);
+
+    std::vector<RunningStats> per_rank(size);
+    MPI_Allgather(&rank_stats, 3, MPI_DOUBLE, per_rank.data(), 3, MPI_DOUBLE, MPI_COMM_WORLD);
+    RunningStats round_stats;
+    for (const RunningStats& s : per_rank) round_stats.merge(s);
+    return round_stats;
+}
+
+// Раунды удваивают выборку, пока стандартная ошибка среднего больше target или не исчерпан max_points
+template<typename F>
+Estimate integrate_mc(const F& f, int dim, uint64_t seed, double target, long long max_points, bool adaptive,
+                      int rank, int size) {
+    auto start = std::chrono::high_resolution_clock::now();
+    RunningStats total;
+    Estimate result;
+    long long round = std::min(FIRST_ROUND, max_points);
+    while (round > 0) {
+        total.merge(mc_round(f, dim, seed, (long long)total.count, round, rank, size));
+        result.rounds++;
+        double std_error = std::sqrt(total.variance() / total.count);
+        if (adaptive && std_error <= target) break;
+        round = std::min((long long)total.count, max_points - (long long)total.count);
+    }
+    result.value = total.mean;
+    result.std_error = std::sqrt(total.variance() / total.count);
+    result.points = (long long)total.count;
+    result.time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    return result;
+}
+
+// Квази-Монте-Карло: для каждой реплики точки [begin, begin + n) Соболя в порядке кода Грея; ранги и потоки
+// делят номера так же, как в mc_round. Возвращает суммы значений по репликам
+template<typename F>
+std::vector<double> qmc_round(const F& f, const Sobol& sobol, const std::vector<uint32_t>& scramble, int dim,
+                              int replicates, long long begin, long long n, int rank, int size) {
+    long long first, count;
+    block_range(n, size, rank, &first, &count);
+    first += begin;
+    long long chunks = (count + POINT_CHUNK - 1) / POINT_CHUNK;
+    std::vector<double> sums(replicates, 0.0);
+    #pragma omp parallel
+    {
+        std::vector<double> local(replicates, 0.0);
+        uint32_t state[MAX_DIM];
+        double x[MAX_DIM];
+        #pragma omp for schedule(static) collapse(2)
+        for (int r = 0; r < replicates; ++r) {
+            for (long long chunk = 0; chunk < chunks; ++chunk) {
+                const uint32_t* seeds = &scramble[r * dim];
+                uint64_t i = first + chunk * POINT_CHUNK, end = first + std::min(count, (chunk + 1) * POINT_CHUNK);
+                for (int d = 0; d < dim; ++d) state[d] = sobol.direct(d, i ^ (i >> 1));
+                double sum = 0.0;
+                for (; i < end; ++i) {
+                    for (int d = 0; d < dim; ++d) x[d] = (owen_scramble(state[d], seeds[d]) + 0.5) * (1.0 / 4294967296.0);
+                    sum += f(x, dim);
+                    // После последней точки шага нет: при i + 1 == 2^SOBOL_BITS номер бита вышел бы за v
+                    if (i + 1 == end) break;
+                    int bit = __builtin_ctzll(i + 1);
+                    for (int d = 0; d < dim; ++d) state[d] ^= sobol.v[d][bit];
+                }
+                local[r] += sum;
+            }
+        }
+        #pragma omp critical
+        for (int r = 0; r < replicates; ++r) sums[r] += local[r];
+    }
+    MPI_Allreduce(MPI_IN_PLACE, sums.data(), replicates, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    return sums;
+}
+
+// Оценка - среднее по репликам, стандартная ошибка - разброс средних реплик / sqrt(replicates).
+// Число точек реплики - степень двойки, на ней сетка Соболя сбалансирована
+template<typename F>
+Estimate integrate_qmc(const F& f, int dim, uint64_t seed, int replicates, double target, long long max_points,
+                       bool adaptive, int rank, int size) {
+    auto start = std::chrono::high_resolution_clock::now();
+    static const Sobol sobol;
+    std::vector<uint32_t> scramble(replicates * dim);
+    for (int r = 0; r < replicates; ++r) {
+        for (int d = 0; d < dim; ++d) scramble[r * dim + d] = (uint32_t)mix64(seed ^ mix64(r * MAX_DIM + d + 1));
+    }
+
+    std::vector<double> totals(replicates, 0.0);
+    long long per_replicate = 0, limit = std::min(max_points / replicates, 1LL << SOBOL_BITS);
+    long long round = std::min(FIRST_ROUND, limit);
+    Estimate result;
+    RunningStats means;
+    while (round > 0) {
+        std::vector<double> sums = qmc_round(f, sobol, scramble, dim, replicates, per_replicate, round, rank, size);
+        per_replicate += round;
+        result.rounds++;
+        means = RunningStats();
+        for (int r = 0; r < replicates; ++r) {
+            totals[r] += sums[r];
+            means.add(totals[r] / per_replicate);
+        }
+        if (adaptive && std::sqrt(means.variance() / replicates) <= target) break;
+        // Следующий раунд удваивает реплику, только пока она остаётся в пределах limit
+        round = 2 * per_replicate <= limit ? per_replicate : 0;
+    }
+    result.value = means.mean;
+    result.std_error = std::sqrt(means.variance() / replicates);
+    result.points = per_replicate * replicates;
+    result.time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    return result;
+}
+
+void print_estimate(const char* name, const Estimate& e, double exact, int size) {
+    std::cout.precision(10);
+    std::cout << name << " integral: " << e.value;
+    std::cout.precision(6);
+    std::cout << " +- " << e.std_error << " (actual error " << std::abs(e.value - exact) << ")\n";
+    std::cout << name << " points: " << e.points << " in " << e.rounds << " rounds, time " << e.time << " seconds, "
+              << e.points / e.time / 1e6 << " M points/s, " << e.points / e.time / 1e6 / (size * omp_get_max_threads())
+              << " per core\n";
+}
+
+template<typename F>
+int run(const F& f, int dim, uint64_t seed, int replicates, double target, long long max_points, bool scaling,
+        int rank, int size) {
+    double exact = f.exact(dim);
+    Estimate qmc = integrate_qmc(f, dim, seed, replicates, target, max_points, true, rank, size);
+    Estimate mc = integrate_mc(f, dim, seed, target, max_points, true, rank, size);
+
+    bool ok = true;
+    if (rank == 0) {
+        std::cout << "Exact integral: " << exact << "\n";
+        print_estimate("QMC (scrambled Sobol)", qmc, exact, size);
+        print_estimate("MC (Philox)", mc, exact, size);
+        std::cout << "Target standard error " << target << " reached: QMC " << (qmc.std_error <= target ? "Yes" : "No")
+                  << ", MC " << (mc.std_error <= target ? "Yes" : "No") << "\n";
+        std::cout << "QMC vs MC: " << (double)mc.points / qmc.points << "x fewer points, " << mc.time / qmc.time << "x faster\n";
+        // Ошибка больше четырёх стандартных почти невероятна при верной оценке разброса
+        ok = std::abs(qmc.value - exact) <= 4 * qmc.std_error + 1e-12 && std::abs(mc.value - exact) <= 4 * mc.std_error + 1e-12;
+        std::cout << "Results match: " << (ok ? "Yes" : "No") << "\n";
+    }
+
+    // Пропускная способность на фиксированном числе точек при 1, 2, 4, ... потоках в каждом процессе
+    if (scaling) {
+        int max_threads = omp_get_max_threads();
+        double base_rate = 0.0;
+        std::vector<int> thread_counts;
+        for (int t = 1; t < max_threads; t *= 2) thread_counts.push_back(t);
+        thread_counts.push_back(max_threads);
+        for (int threads : thread_counts) {
+            omp_set_num_threads(threads);
+            MPI_Barrier(MPI_COMM_WORLD);
+            Estimate fixed = integrate_qmc(f, dim, seed, replicates, 0.0, SCALING_POINTS * size, false, rank, size);
+            double rate = fixed.points / fixed.time / (size * threads);
+            if (threads == 1) base_rate = rate;
+            if (rank == 0) {
+                std::cout << "Scaling: " << size << " processes x " << threads << " threads, " << fixed.points / fixed.time / 1e6
+                          << " M points/s, " << rate / 1e6 << " per core, efficiency " << rate / base_rate * 100 << "%\n";
+            }
+        }
+        omp_set_num_threads(max_threads);
+    }
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    MPI_Init(&argc, &argv);
+
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    // С одинаковым --seed точки (и оценки с точностью до округления сумм) одинаковы при любом -np и числе потоков
+    uint64_t seed = std::random_device()();
+    int dim = DEFAULT_DIM, replicates = DEFAULT_REPLICATES;
+    double target = DEFAULT_TARGET;
+    long long max_points = DEFAULT_MAX_POINTS;
+    std::string function = "g";
+    bool scaling = false, valid = true;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--seed" && has_value) {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--dim" && has_value) {
+            dim = std::atoi(argv[++i]);
+        } else if (arg == "--replicates" && has_value) {
+            replicates = std::atoi(argv[++i]);
+        } else if (arg == "--target" && has_value) {
+            target = std::atof(argv[++i]);
+        } else if (arg == "--max-points" && has_value) {
+            max_points = std::atoll(argv[++i]);
+        } else if (arg == "--function" && has_value) {
+            function = argv[++i];
+        } else if (arg == "--scaling") {
+            scaling = true;
+        } else {
+            valid = false;
+        }
+    }
+    if (dim < 1 || dim > MAX_DIM || replicates < 2 || max_points < replicates || (function != "g" && function != "gauss")) {
+        valid = false;
+    }
+    if (!valid) {
+        if (rank == 0) {
+            std::cerr << "Usage: " << argv[0] << " [--dim 1.." << MAX_DIM << "] [--function g|gauss] [--target STD_ERROR]"
+                      << " [--max-points N] [--replicates R] [--seed N] [--scaling]\n";
+        }
+        MPI_Finalize();
+        return 1;
+    }
+    MPI_Bcast(&seed, 1, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        std::cout << "Integrand: " << (function == "g" ? "Sobol g-function" : "exp(-|x|^2)") << ", dimension " << dim
+                  << ", seed " << seed << ", " << size << " processes x " << omp_get_max_threads() << " threads\n";
+    }
+    int status = function == "g" ? run(GFunction(), dim, seed, replicates, target, max_points, scaling, rank, size)
+                                 : run(Gaussian(), dim, seed, replicates, target, max_points, scaling, rank, size);
+
+    MPI_Finalize();
+    return status;
+}
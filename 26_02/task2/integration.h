@@ -0,0 +1,283 @@
+#pragma once
+// Интегрирование функций одной переменной: подынтегральная функция - параметр шаблона (лямбда или функтор),
+// поэтому её вызов встраивается в цикл по узлам. Границы и число узлов задаются при вызове
+#include <cmath>
+#include <cstdint>
+#include <array>
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include <omp.h>
+
+// Векторные варианты циклов собираются под AVX2 и выбираются при запуске
+#ifndef SIMD_KERNELS
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_KERNELS 1
+#else
+#define SIMD_KERNELS 0
+#endif
+#endif
+
+// Цепочка от цикла по блокам до функтора встраивается целиком, иначе векторный вариант цикла вызывал бы скалярный код
+#if defined(__GNUC__)
+#define INTEGRAND_INLINE inline __attribute__((always_inline))
+#else
+#define INTEGRAND_INLINE inline
+#endif
+
+// Число абсцисс в блоке пакетного вызова; 16 узлов Кронрода (15 и один повтор центра) - целое число блоков
+#define INTEGRAND_BATCH 8
+#define MIDPOINT_CHUNK 1024
+#define ADAPTIVE_MAX_DEPTH 50
+#define ADAPTIVE_TASK_DEPTH 12
+// Общий на весь вызов предел числа вычислений f, как limit в QUADPACK
+#define ADAPTIVE_MAX_EVALUATIONS (1LL << 24)
+
+// Функтор может вычислять сразу блок из INTEGRAND_BATCH абсцисс: void batch(const double* x, double* y) const.
+// Если метода нет, блок вычисляется поточечно через operator(). Оба метода должны быть видны компилятору (определены
+// в классе), чтобы встроиться в векторный вариант цикла
+template<typename F, typename = void> struct has_batch : std::false_type {};
+template<typename F>
+struct has_batch<F, decltype(std::declval<const F&>().batch((const double*)nullptr, (double*)nullptr), void())>
+    : std::true_type {};
+
+template<typename F> INTEGRAND_INLINE void evaluate_block(const F& f, const double* x, double* y) {
+    if constexpr (has_batch<F>::value) {
+        f.batch(x, y);
+    } else {
+        for (int j = 0; j < INTEGRAND_BATCH; ++j) y[j] = f(x[j]);
+    }
+}
+
+template<typename F> INTEGRAND_INLINE double block_sum(const F& f, const double* x) {
+    double y[INTEGRAND_BATCH];
+    evaluate_block(f, x, y);
+    double sum = 0.0;
+    for (int j = 0; j < INTEGRAND_BATCH; ++j) sum += y[j];
+    return sum;
+}
+
+// exp для блока без ветвлений, цикл векторизуется: x = k ln2 + r, |r| <= ln2 / 2, exp(r) - ряд Тейлора до r^12
+// (относительная ошибка порядка 1e-16). 2^k собирается в битах порядка из двух половин, поэтому денормализованные
+// значения, ноль и бесконечность на краях (в том числе при x = -inf и +inf) получаются как у std::exp
+INTEGRAND_INLINE void exp_batch(const double* x, double* y) {
+    const double round_shift = 6755399441055744.0; // 1.5 * 2^52: младшие биты мантиссы суммы - целое k
+    // Аргумент сначала приводится к безопасному отдельным циклом: выше 710 exp уже бесконечность, и 710 оставляет k
+    // в пределах порядка; ниже -746 ответ - ноль: считается exp(0) и умножается на 0, чтобы не получать ноль
+    // через исчезновение порядка (медленно на x86). Выбор внутри основного цикла компилятор превращает в ветвления,
+    // и цикл перестаёт векторизоваться. NaN проходит все сравнения и даёт NaN; x и y могут совпадать
+    double clamped[INTEGRAND_BATCH], keep[INTEGRAND_BATCH];
+    #pragma omp simd
+    for (int j = 0; j < INTEGRAND_BATCH; ++j) {
+        keep[j] = x[j] < -746.0 ? 0.0 : 1.0;
+        double v = x[j] < -746.0 ? 0.0 : x[j];
+        clamped[j] = v > 710.0 ? 710.0 : v;
+    }
+    #pragma omp simd
+    for (int j = 0; j < INTEGRAND_BATCH; ++j) {
+        double v = clamped[j];
+        double t = v * 1.4426950408889634 + round_shift;
+        double k = t - round_shift;
+        double r = (v - k * 6.93147180369123816490e-01) - k * 1.90821492927058770002e-10;
+        double p = 1.0 / 479001600.0;
+        p = p * r + 1.0 / 39916800.0;
+        p = p * r + 1.0 / 3628800.0;
+        p = p * r + 1.0 / 362880.0;
+        p = p * r + 1.0 / 40320.0;
+        p = p * r + 1.0 / 5040.0;
+        p = p * r + 1.0 / 720.0;
+        p = p * r + 1.0 / 120.0;
+        p = p * r + 1.0 / 24.0;
+        p = p * r + 1.0 / 6.0;
+        p = p * r + 0.5;
+        p = p * r + 1.0;
+        p = p * r + 1.0;
+        // 2^k = 2^(k/2) * 2^(k - k/2): половины округляются тем же сдвигом, целые биты мантиссы сразу идут в порядок
+        double th = k * 0.5 + round_shift;
+        double tl = (k - (th - round_shift)) + round_shift;
+        double low = __builtin_bit_cast(double, (__builtin_bit_cast(int64_t, th) + 1023) << 52);
+        double high = __builtin_bit_cast(double, (__builtin_bit_cast(int64_t, tl) + 1023) << 52);
+        y[j] = p * low * high * keep[j];
+    }
+}
+
+// Блоки узлов [begin, end) правила средних точек, суммы функций добавляются в sums.
+// Абсциссы блока строятся один раз и подаются всем функциям
+template<typename... F>
+INTEGRAND_INLINE void midpoint_blocks(double a, double dx, long long begin, long long end, double* sums, const F&... fs) {
+    for (long long block = begin; block < end; ++block) {
+        double first = a + ((double)(block * INTEGRAND_BATCH) + 0.5) * dx;
+        double x[INTEGRAND_BATCH];
+        for (int j = 0; j < INTEGRAND_BATCH; ++j) x[j] = first + j * dx;
+        size_t k = 0;
+        ((sums[k++] += block_sum(fs, x)), ...);
+    }
+}
+
+#if SIMD_KERNELS
+// Тот же цикл, собранный под AVX2 и FMA: flatten встраивает в него функторы вместе с exp_batch независимо от их размера,
+// и они векторизуются на 4 double
+template<typename... F>
+__attribute__((target("avx2,fma"), flatten))
+void midpoint_blocks_avx2(double a, double dx, long long begin, long long end, double* sums, const F&... fs) {
+    midpoint_blocks(a, dx, begin, end, sums, fs...);
+}
+#endif
+
+inline bool use_avx2() {
+#if SIMD_KERNELS
+    static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+// Правило средних точек на n узлах [a, b] сразу для нескольких функций за один проход.
+// Потоки берут порции по MIDPOINT_CHUNK блоков и копят свои суммы, в конце суммы складываются
+template<typename... F>
+std::array<double, sizeof...(F)> integrate_midpoint_many(double a, double b, long long n, const F&... fs) {
+    constexpr size_t count = sizeof...(F);
+    std::array<double, count> total{};
+    double dx = (b - a) / n;
+    long long blocks = n / INTEGRAND_BATCH;
+    long long chunks = (blocks + MIDPOINT_CHUNK - 1) / MIDPOINT_CHUNK;
+    bool avx2 = use_avx2();
+    #pragma omp parallel
+    {
+        std::array<double, count> local{};
+        #pragma omp for nowait
+        for (long long chunk = 0; chunk < chunks; ++chunk) {
+            long long begin = chunk * MIDPOINT_CHUNK, end = std::min(blocks, begin + MIDPOINT_CHUNK);
+#if SIMD_KERNELS
+            if (avx2) {
+                midpoint_blocks_avx2(a, dx, begin, end, local.data(), fs...);
+                continue;
+            }
+#endif
+            midpoint_blocks(a, dx, begin, end, local.data(), fs...);
+        }
+        #pragma omp critical
+        for (size_t k = 0; k < count; ++k) total[k] += local[k];
+    }
+    for (long long i = blocks * INTEGRAND_BATCH; i < n; ++i) {
+        double x = a + (i + 0.5) * dx;
+        size_t k = 0;
+        ((total[k++] += fs(x)), ...);
+    }
+    for (size_t k = 0; k < count; ++k) total[k] *= dx;
+    return total;
+}
+
+template<typename F> double integrate_midpoint(const F& f, double a, double b, long long n) {
+    return integrate_midpoint_many(a, b, n, f)[0];
+}
+
+// Последовательный вариант: по одной точке, без блоков и потоков
+template<typename F> double integrate_midpoint_sequential(const F& f, double a, double b, long long n) {
+    double dx = (b - a) / n;
+    double sum = 0.0;
+    for (long long i = 0; i < n; ++i) sum += f(a + (i + 0.5) * dx);
+    return sum * dx;
+}
+
+// Узлы Кронрода на [0, 1] (узлы с нечётным номером - узлы Гаусса, последний - центр) и веса обоих правил
+static const double XGK[8] = {
+    0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+    0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+    0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+    0.207784955007898467600689403773245, 0.0,
+};
+static const double WGK[8] = {
+    0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+    0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+    0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+    0.204432940075298892414161999234649, 0.209482141084727828012999174891714,
+};
+static const double WG[4] = {
+    0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+    0.381830050505118944950369775488975, 0.417959183673469387755102040816327,
+};
+static_assert(16 % INTEGRAND_BATCH == 0, "Kronrod nodes must fill whole batches");
+
+struct QuadResult {
+    double value = 0.0;
+    double error = 0.0;
+    long long evaluations = 0;
+    bool converged = true; // false - исчерпан предел вычислений или глубины, или ошибка не конечна
+};
+
+// 15 вычислений f: значение по Кронроду, ошибка - его разность с вложенным правилом Гаусса на 7 узлах.
+// Узлы лежат парами center -+ dx, шестнадцатый повторяет центр, чтобы блоки были полными
+template<typename F> void gauss_kronrod(const F& f, double a, double b, double& value, double& error) {
+    double center = 0.5 * (a + b), half = 0.5 * (b - a);
+    double x[16], y[16];
+    for (int j = 0; j < 7; ++j) {
+        x[2 * j] = center - half * XGK[j];
+        x[2 * j + 1] = center + half * XGK[j];
+    }
+    x[14] = x[15] = center;
+    for (int j = 0; j < 16; j += INTEGRAND_BATCH) evaluate_block(f, x + j, y + j);
+    double kronrod = y[14] * WGK[7], gauss = y[14] * WG[3];
+    for (int j = 0; j < 7; ++j) {
+        double pair = y[2 * j] + y[2 * j + 1];
+        kronrod += WGK[j] * pair;
+        if (j % 2 == 1) gauss += WG[j / 2] * pair;
+    }
+    value = kronrod * half;
+    error = std::abs((kronrod - gauss) * half);
+}
+
+// Интервал [a, b] с уже посчитанными value и error: если ошибка больше tol, обе половины уточняются с допуском tol / 2.
+// Левая половина идёт отдельной задачей, правая - в текущей; общей очереди и блокировок нет, суммы сводит родитель.
+// budget - оставшееся на весь вызов число вычислений f, его уменьшают все задачи
+template<typename F>
+void adaptive_interval(const F& f, double a, double b, double value, double error, double tol, int depth,
+                       long long& budget, QuadResult& out) {
+    out.value = value;
+    out.error = error;
+    out.evaluations = 0;
+    // Ошибку ниже шума округления value уменьшить уже нельзя
+    if (error <= tol || error <= 50.0 * 2.2e-16 * std::abs(value)) return;
+    // NaN не проходит ни одно сравнение выше: деление его не уберёт, значение отдаётся как есть
+    if (!std::isfinite(error) || depth >= ADAPTIVE_MAX_DEPTH) {
+        out.converged = false;
+        return;
+    }
+    long long left_budget;
+    #pragma omp atomic capture
+    left_budget = budget -= 30;
+    if (left_budget < 0) {
+        out.converged = false;
+        return;
+    }
+    double mid = 0.5 * (a + b);
+    double left_value, left_error, right_value, right_error;
+    gauss_kronrod(f, a, mid, left_value, left_error);
+    gauss_kronrod(f, mid, b, right_value, right_error);
+
+    QuadResult left, right;
+    #pragma omp task shared(f, left, budget) final(depth >= ADAPTIVE_TASK_DEPTH)
+    adaptive_interval(f, a, mid, left_value, left_error, 0.5 * tol, depth + 1, budget, left);
+    adaptive_interval(f, mid, b, right_value, right_error, 0.5 * tol, depth + 1, budget, right);
+    #pragma omp taskwait
+
+    out.value = left.value + right.value;
+    out.error = left.error + right.error;
+    out.evaluations = 30 + left.evaluations + right.evaluations;
+    out.converged = left.converged && right.converged;
+}
+
+// Допуск - max(abs_tol, rel_tol * |I|), где I - первая оценка по всему отрезку
+template<typename F> QuadResult integrate_adaptive(const F& f, double a, double b, double abs_tol, double rel_tol) {
+    double value, error;
+    gauss_kronrod(f, a, b, value, error);
+    double tol = std::max(abs_tol, rel_tol * std::abs(value));
+    QuadResult result;
+    long long budget = ADAPTIVE_MAX_EVALUATIONS - 15;
+    #pragma omp parallel
+    #pragma omp single
+    adaptive_interval(f, a, b, value, error, tol, 0, budget, result);
+    result.evaluations += 15;
+    return result;
+}
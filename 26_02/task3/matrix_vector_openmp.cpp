@@ -2,10 +2,34 @@
 #include <vector>
 #include <random>
 #include <chrono>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <memory>
 #include <omp.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "../../common/autotune.h"
+#include "../../common/matrix_file.h"
+#include "../../common/precision.h"
 
 #define ROWS 1000
 #define COLS 1000
+#define REPEAT 20
+#define SPMV_REPEAT 100
+#define DENSE_CHECK_LIMIT (4096 * 4096)
+#define BATCH_ROWS 4096
+#define BATCH_COLS 4096
+#define BATCH_REPEAT 5
+#define BATCH_ROW_BLOCK 4
+#define STREAM_ELEMENTS (1 << 24)
+#define OOC_PANEL 1024
 
 void initialize_matrix_vector(std::vector<std::vector<double>>& matrix, std::vector<double>& vector) {
     std::random_device rd;
@@ -24,19 +48,25 @@ void initialize_matrix_vector(std::vector<std::vector<double>>& matrix, std::vec
     }
 }
 
+TuneCache tune_cache;
+
 void multiply_sequential(const std::vector<std::vector<double>>& matrix, const std::vector<double>& vector, std::vector<double>& result) {
-    result.resize(ROWS);
-    for (int i = 0; i < ROWS; ++i) {
+    int rows = (int)matrix.size(), cols = (int)vector.size();
+    result.resize(rows);
+    for (int i = 0; i < rows; ++i) {
         result[i] = 0.0;
-        for (int j = 0; j < COLS; ++j) {
+        for (int j = 0; j < cols; ++j) {
             result[i] += matrix[i][j] * vector[j];
         }
     }
 }
 
-void multiply_parallel(const std::vector<std::vector<double>>& matrix, const std::vector<double>& vector, std::vector<double>& result) {
+// По умолчанию - прежнее статическое расписание на всех потоках
+void multiply_parallel(const std::vector<std::vector<double>>& matrix, const std::vector<double>& vector, std::vector<double>& result,
+                       const TuneConfig& config) {
     result.resize(ROWS);
-    #pragma omp parallel for
+    omp_set_schedule(config.schedule, config.chunk);
+    #pragma omp parallel for schedule(runtime) num_threads(config_threads(config))
     for (int i = 0; i < ROWS; ++i) {
         result[i] = 0.0;
         for (int j = 0; j < COLS; ++j) {
@@ -45,11 +75,590 @@ void multiply_parallel(const std::vector<std::vector<double>>& matrix, const std
     }
 }
 
-int main() {
+void multiply_parallel(const std::vector<std::vector<double>>& matrix, const std::vector<double>& vector, std::vector<double>& result) {
+    multiply_parallel(matrix, vector, result, tune_cache.lookup("dense", ROWS, TuneConfig()));
+}
+
+template<typename T, typename Acc>
+void multiply_typed(const std::vector<T>& matrix, const std::vector<T>& vector, std::vector<Acc>& result, int rows, int cols) {
+    result.resize(rows);
+    #pragma omp parallel for
+    for (int i = 0; i < rows; ++i) {
+        result[i] = dot<T, Acc>(&matrix[(size_t)i * cols], vector.data(), cols);
+    }
+}
+
+template void multiply_typed<double, double>(const std::vector<double>&, const std::vector<double>&, std::vector<double>&, int, int);
+template void multiply_typed<float, float>(const std::vector<float>&, const std::vector<float>&, std::vector<float>&, int, int);
+template void multiply_typed<bf16, float>(const std::vector<bf16>&, const std::vector<bf16>&, std::vector<float>&, int, int);
+template void multiply_typed<int8_t, int32_t>(const std::vector<int8_t>&, const std::vector<int8_t>&, std::vector<int32_t>&, int, int);
+
+// Наибольшая по модулю разность, отнесённая к наибольшему по модулю элементу эталона
+double max_relative_error(const std::vector<double>& expected, const std::vector<double>& actual) {
+    double max_diff = 0.0, max_value = 0.0;
+    for (size_t i = 0; i < expected.size(); i++) {
+        max_diff = std::max(max_diff, std::abs(expected[i] - actual[i]));
+        max_value = std::max(max_value, std::abs(expected[i]));
+    }
+    return max_value > 0.0 ? max_diff / max_value : max_diff;
+}
+
+// Матрица и вектор переводятся в T, время - среднее по REPEAT умножениям; в байты входят матрица, вектор и результат
+template<typename T, typename Acc>
+void run_precision(const char* name, const std::vector<double>& matrix, const std::vector<double>& vector,
+                   const std::vector<double>& reference) {
+    double matrix_scale = storage_scale<T>(matrix), vector_scale = storage_scale<T>(vector);
+    std::vector<T> typed_matrix = encode_all<T>(matrix, matrix_scale);
+    std::vector<T> typed_vector = encode_all<T>(vector, vector_scale);
+    std::vector<Acc> result;
+    multiply_typed<T, Acc>(typed_matrix, typed_vector, result, ROWS, COLS);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < REPEAT; ++r) {
+        multiply_typed<T, Acc>(typed_matrix, typed_vector, result, ROWS, COLS);
+    }
+    double time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count() / REPEAT;
+
+    std::vector<double> decoded(ROWS);
+    for (int i = 0; i < ROWS; ++i) decoded[i] = (double)result[i] * matrix_scale * vector_scale;
+    double bytes = (double)ROWS * COLS * sizeof(T) + COLS * sizeof(T) + ROWS * sizeof(Acc);
+    std::cout << name << ": " << time << " seconds, " << 2.0 * ROWS * COLS / time / 1e9 << " GFLOP/s, "
+              << bytes / (1024.0 * 1024.0) << " MB moved (" << bytes / time / 1e9 << " GB/s), max relative error "
+              << max_relative_error(reference, decoded) << "\n";
+}
+
+// Разреженная матрица в формате CSR: ненулевые строки i лежат в values[row_ptr[i] .. row_ptr[i + 1])
+struct CsrMatrix {
+    int rows = 0;
+    int cols = 0;
+    std::vector<int64_t> row_ptr;
+    std::vector<int> col_idx;
+    std::vector<double> values;
+
+    int64_t nnz() const { return row_ptr.empty() ? 0 : row_ptr.back(); }
+};
+
+// Сборка CSR из троек (строка, столбец, значение) подсчётом по строкам; внутри строки столбцы упорядочиваются
+void build_csr(CsrMatrix& csr, int rows, int cols, const std::vector<int>& ri, const std::vector<int>& ci,
+               const std::vector<double>& vi) {
+    csr.rows = rows;
+    csr.cols = cols;
+    csr.row_ptr.assign(rows + 1, 0);
+    for (int r : ri) csr.row_ptr[r + 1]++;
+    for (int i = 0; i < rows; ++i) csr.row_ptr[i + 1] += csr.row_ptr[i];
+    csr.col_idx.resize(ri.size());
+    csr.values.resize(ri.size());
+    std::vector<int64_t> next(csr.row_ptr.begin(), csr.row_ptr.end() - 1);
+    for (size_t t = 0; t < ri.size(); ++t) {
+        int64_t pos = next[ri[t]]++;
+        csr.col_idx[pos] = ci[t];
+        csr.values[pos] = vi[t];
+    }
+    for (int i = 0; i < rows; ++i) {
+        std::vector<std::pair<int, double>> row;
+        for (int64_t k = csr.row_ptr[i]; k < csr.row_ptr[i + 1]; ++k) row.push_back({ csr.col_idx[k], csr.values[k] });
+        std::sort(row.begin(), row.end());
+        for (size_t k = 0; k < row.size(); ++k) {
+            csr.col_idx[csr.row_ptr[i] + k] = row[k].first;
+            csr.values[csr.row_ptr[i] + k] = row[k].second;
+        }
+    }
+}
+
+// Matrix Market, формат coordinate: real/integer/pattern, general/symmetric/skew-symmetric.
+// У симметричных матриц хранится нижний треугольник, верхний достраивается при чтении.
+bool read_matrix_market(const std::string& path, CsrMatrix& csr, std::string& error) {
+    std::ifstream in(path);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::string line;
+    std::getline(in, line);
+    std::istringstream header(line);
+    std::string banner, object, format, field, symmetry;
+    header >> banner >> object >> format >> field >> symmetry;
+    if (banner != "%%MatrixMarket" || object != "matrix" || format != "coordinate") {
+        error = "only coordinate Matrix Market matrices are supported";
+        return false;
+    }
+    bool pattern = field == "pattern";
+    if (!pattern && field != "real" && field != "integer") {
+        error = "unsupported field " + field;
+        return false;
+    }
+    bool symmetric = symmetry == "symmetric", skew = symmetry == "skew-symmetric";
+    if (!symmetric && !skew && symmetry != "general") {
+        error = "unsupported symmetry " + symmetry;
+        return false;
+    }
+
+    while (std::getline(in, line) && (line.empty() || line[0] == '%')) {}
+    int rows, cols;
+    int64_t entries;
+    if (!(std::istringstream(line) >> rows >> cols >> entries)) {
+        error = "bad size line";
+        return false;
+    }
+
+    std::vector<int> ri, ci;
+    std::vector<double> vi;
+    ri.reserve(entries);
+    ci.reserve(entries);
+    vi.reserve(entries);
+    for (int64_t e = 0; e < entries; ++e) {
+        int r, c;
+        double v = 1.0;
+        if (!(in >> r >> c) || (!pattern && !(in >> v)) || r < 1 || r > rows || c < 1 || c > cols) {
+            error = "bad entry " + std::to_string(e + 1);
+            return false;
+        }
+        ri.push_back(r - 1);
+        ci.push_back(c - 1);
+        vi.push_back(v);
+        if ((symmetric || skew) && r != c) {
+            ri.push_back(c - 1);
+            ci.push_back(r - 1);
+            vi.push_back(skew ? -v : v);
+        }
+    }
+    build_csr(csr, rows, cols, ri, ci, vi);
+    return true;
+}
+
+// Случайная матрица с сильно неравными строками: число ненулевых в строке ~ avg * 4 * u^3, u из [0, 1)
+void generate_sparse(CsrMatrix& csr, int n, int avg_per_row) {
+    std::mt19937 gen(12345);
+    std::uniform_real_distribution<> unit(0.0, 1.0), dis(0.0, 10.0);
+    std::uniform_int_distribution<> column(0, n - 1);
+    std::vector<int> ri, ci;
+    std::vector<double> vi;
+    for (int i = 0; i < n; ++i) {
+        double u = unit(gen);
+        int count = std::min(n, std::max(1, (int)(avg_per_row * 4 * u * u * u)));
+        for (int k = 0; k < count; ++k) {
+            ri.push_back(i);
+            ci.push_back(column(gen));
+            vi.push_back(dis(gen));
+        }
+    }
+    build_csr(csr, n, n, ri, ci, vi);
+}
+
+// Границы строк для parts потоков так, чтобы каждому досталось примерно nnz / parts ненулевых
+std::vector<int> partition_by_nnz(const CsrMatrix& csr, int parts) {
+    std::vector<int> bounds(parts + 1, csr.rows);
+    bounds[0] = 0;
+    for (int t = 1; t < parts; ++t) {
+        int64_t target = csr.nnz() * t / parts;
+        bounds[t] = (int)(std::lower_bound(csr.row_ptr.begin(), csr.row_ptr.end(), target) - csr.row_ptr.begin());
+        bounds[t] = std::max(bounds[t - 1], std::min(bounds[t], csr.rows));
+    }
+    return bounds;
+}
+
+inline double csr_row_dot(const CsrMatrix& csr, int i, const std::vector<double>& x) {
+    double sum = 0.0;
+    for (int64_t k = csr.row_ptr[i]; k < csr.row_ptr[i + 1]; ++k) {
+        sum += csr.values[k] * x[csr.col_idx[k]];
+    }
+    return sum;
+}
+
+// Поток t считает строки [bounds[t], bounds[t + 1]); если потоков выдали меньше, части берутся по кругу
+void spmv_balanced(const CsrMatrix& csr, const std::vector<int>& bounds, const std::vector<double>& x, std::vector<double>& y) {
+    int parts = (int)bounds.size() - 1;
+    #pragma omp parallel num_threads(parts)
+    for (int t = omp_get_thread_num(); t < parts; t += omp_get_num_threads()) {
+        for (int i = bounds[t]; i < bounds[t + 1]; ++i) {
+            y[i] = csr_row_dot(csr, i, x);
+        }
+    }
+}
+
+// Для сравнения: поровну строк на поток, как в multiply_parallel
+void spmv_by_rows(const CsrMatrix& csr, const std::vector<double>& x, std::vector<double>& y, const TuneConfig& config) {
+    omp_set_schedule(config.schedule, config.chunk);
+    #pragma omp parallel for schedule(runtime) num_threads(config_threads(config))
+    for (int i = 0; i < csr.rows; ++i) {
+        y[i] = csr_row_dot(csr, i, x);
+    }
+}
+
+void spmv_by_rows(const CsrMatrix& csr, const std::vector<double>& x, std::vector<double>& y) {
+    spmv_by_rows(csr, x, y, tune_cache.lookup("spmv", csr.rows, TuneConfig()));
+}
+
+// Байты одного SpMV: значения и индексы столбцов, row_ptr, x (один раз) и запись y
+double spmv_bytes(const CsrMatrix& csr) {
+    return (double)csr.nnz() * (sizeof(double) + sizeof(int)) + (csr.rows + 1.0) * sizeof(int64_t)
+           + (double)csr.cols * sizeof(double) + (double)csr.rows * sizeof(double);
+}
+
+int run_sparse(const CsrMatrix& csr, int repeat, bool tune) {
+    std::mt19937 gen(54321);
+    std::uniform_real_distribution<> dis(0.0, 10.0);
+    std::vector<double> x(csr.cols), y(csr.rows), y_rows(csr.rows);
+    for (double& v : x) v = dis(gen);
+
+    // Обоим ядрам подбирается число потоков; у разбиения по ненулевым оно же число частей, а расписания нет
+    if (tune) {
+        TuneConfig best = autotune("spmv", tune_cache.lookup("spmv", csr.rows, TuneConfig()), {}, [&](const TuneConfig& config) {
+            for (int r = 0; r < repeat; ++r) spmv_by_rows(csr, x, y_rows, config);
+        });
+        tune_cache.store("spmv", csr.rows, best);
+        TuneSpace balanced_space;
+        balanced_space.schedules = false;
+        best = autotune("spmv_balanced", tune_cache.lookup("spmv_balanced", csr.rows, TuneConfig()), balanced_space,
+                        [&](const TuneConfig& config) {
+            std::vector<int> parts = partition_by_nnz(csr, config_threads(config));
+            for (int r = 0; r < repeat; ++r) spmv_balanced(csr, parts, x, y);
+        });
+        tune_cache.store("spmv_balanced", csr.rows, best);
+    }
+
+    int threads = config_threads(tune_cache.lookup("spmv_balanced", csr.rows, TuneConfig()));
+    std::vector<int> bounds = partition_by_nnz(csr, threads);
+    int64_t max_part = 0;
+    for (int t = 0; t < threads; ++t) max_part = std::max(max_part, csr.row_ptr[bounds[t + 1]] - csr.row_ptr[bounds[t]]);
+    std::cout << "CSR: " << csr.rows << "x" << csr.cols << ", " << csr.nnz() << " nonzeros ("
+              << 100.0 * csr.nnz() / ((double)csr.rows * csr.cols) << "% dense), " << threads
+              << " threads, largest thread share " << max_part << " nonzeros\n";
+
+    // Проверка по плотному эталону: multiply_sequential на той же матрице, развёрнутой в плотную
+    bool correct = true;
+    if ((double)csr.rows * csr.cols <= DENSE_CHECK_LIMIT) {
+        std::vector<std::vector<double>> dense(csr.rows, std::vector<double>(csr.cols, 0.0));
+        for (int i = 0; i < csr.rows; ++i)
+            for (int64_t k = csr.row_ptr[i]; k < csr.row_ptr[i + 1]; ++k) dense[i][csr.col_idx[k]] += csr.values[k];
+        std::vector<double> reference;
+        multiply_sequential(dense, x, reference);
+        spmv_balanced(csr, bounds, x, y);
+        for (int i = 0; i < csr.rows; ++i) {
+            if (std::abs(reference[i] - y[i]) > 1e-6 * std::max(1.0, std::abs(reference[i]))) {
+                correct = false;
+                break;
+            }
+        }
+        std::cout << "Results match (dense reference): " << (correct ? "Yes" : "No") << "\n";
+    } else {
+        std::cout << "Dense reference skipped: matrix too large\n";
+    }
+
+    auto benchmark = [&](const char* name, auto&& spmv) {
+        spmv();
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int r = 0; r < repeat; ++r) spmv();
+        double time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count() / repeat;
+        std::cout << name << ": " << time << " seconds per SpMV, " << 2.0 * csr.nnz() / time / 1e9 << " GFLOP/s, "
+                  << spmv_bytes(csr) / time / 1e9 << " GB/s effective\n";
+    };
+    benchmark("Balanced by nonzeros", [&] { spmv_balanced(csr, bounds, x, y); });
+    benchmark("Balanced by rows", [&] { spmv_by_rows(csr, x, y_rows); });
+    return correct ? 0 : 1;
+}
+
+// Первое касание: память выделяется без инициализации и заполняется тем же статическим разбиением
+// блоков строк, что и в multiply_batched, поэтому страницы строк потока оказываются на его узле NUMA
+std::unique_ptr<double[]> allocate_first_touch(int rows, int cols, uint64_t seed) {
+    std::unique_ptr<double[]> data(new double[(size_t)rows * cols]);
+    double* out = data.get();
+    #pragma omp parallel for schedule(static)
+    for (int i0 = 0; i0 < rows; i0 += BATCH_ROW_BLOCK) {
+        for (int i = i0; i < std::min(i0 + BATCH_ROW_BLOCK, rows); ++i) {
+            for (int j = 0; j < cols; ++j) {
+                out[(size_t)i * cols + j] = matrix_element(seed, i, j);
+            }
+        }
+    }
+    return data;
+}
+
+// Пиковая пропускная способность памяти по образцу STREAM triad: a = b + s * c, 24 байта на элемент
+double measure_stream_triad() {
+    const size_t n = STREAM_ELEMENTS;
+    std::unique_ptr<double[]> a(new double[n]), b(new double[n]), c(new double[n]);
+    double *pa = a.get(), *pb = b.get(), *pc = c.get();
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < n; ++i) {
+        pa[i] = 0.0;
+        pb[i] = 1.0;
+        pc[i] = 2.0;
+    }
+    double best = 1e30;
+    for (int r = 0; r < BATCH_REPEAT; ++r) {
+        auto start = std::chrono::high_resolution_clock::now();
+        #pragma omp parallel for schedule(static)
+        for (size_t i = 0; i < n; ++i) {
+            pa[i] = pb[i] + 3.0 * pc[i];
+        }
+        best = std::min(best, std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count());
+    }
+    return 3.0 * sizeof(double) * n / best / 1e9;
+}
+
+// Строка a на KB соседних правых частей сразу (скалярный вариант): элемент матрицы читается один раз.
+// Правые части хранятся вперемешку: X[j * k + v] - j-й элемент вектора v.
+template<int KB>
+inline void row_times_block(const double* a, int cols, const double* X, int k, int v0, double* y) {
+    double acc[KB] = {};
+    for (int j = 0; j < cols; ++j) {
+        double aij = a[j];
+        const double* x = X + (size_t)j * k + v0;
+        for (int v = 0; v < KB; ++v) {
+            acc[v] += aij * x[v];
+        }
+    }
+    for (int v = 0; v < KB; ++v) y[v0 + v] = acc[v];
+}
+
+#if SIMD_KERNELS
+// Регистровый блок 4 строки x (4 * NV) правых частей: 4 * NV независимых сумм в ymm,
+// каждая загрузка X используется четырьмя строками, каждый элемент A - всеми векторами блока
+template<int NV>
+__attribute__((target("avx2,fma")))
+void rows4_times_block_avx2(const double* a, int cols, const double* X, int k, int v0, double* y) {
+    __m256d acc[4][NV];
+    for (int r = 0; r < 4; ++r)
+        for (int q = 0; q < NV; ++q) acc[r][q] = _mm256_setzero_pd();
+    for (int j = 0; j < cols; ++j) {
+        const double* x = X + (size_t)j * k + v0;
+        __m256d xv[NV];
+        for (int q = 0; q < NV; ++q) xv[q] = _mm256_loadu_pd(x + 4 * q);
+        for (int r = 0; r < 4; ++r) {
+            __m256d aij = _mm256_broadcast_sd(a + (size_t)r * cols + j);
+            for (int q = 0; q < NV; ++q) acc[r][q] = _mm256_fmadd_pd(aij, xv[q], acc[r][q]);
+        }
+    }
+    for (int r = 0; r < 4; ++r)
+        for (int q = 0; q < NV; ++q) _mm256_storeu_pd(y + (size_t)r * k + v0 + 4 * q, acc[r][q]);
+}
+#endif
+
+// Блок из BATCH_ROW_BLOCK строк: k = 1 - обычное скалярное произведение, иначе блоки по 8, 4 и остаток
+void row_block_times_batch(const double* a, int block_rows, int cols, const double* X, int k, double* y) {
+    if (k == 1) {
+        for (int r = 0; r < block_rows; ++r) y[r] = dot<double, double>(a + (size_t)r * cols, X, cols);
+        return;
+    }
+    int v0 = 0;
+#if SIMD_KERNELS
+    if (use_avx2 && block_rows == BATCH_ROW_BLOCK) {
+        for (; v0 + 8 <= k; v0 += 8) rows4_times_block_avx2<2>(a, cols, X, k, v0, y);
+        if (v0 + 4 <= k) { rows4_times_block_avx2<1>(a, cols, X, k, v0, y); v0 += 4; }
+    }
+#endif
+    for (int r = 0; r < block_rows; ++r) {
+        const double* row = a + (size_t)r * cols;
+        double* out = y + (size_t)r * k;
+        int v = v0;
+        for (; v + 8 <= k; v += 8) row_times_block<8>(row, cols, X, k, v, out);
+        if (v + 4 <= k) { row_times_block<4>(row, cols, X, k, v, out); v += 4; }
+        if (v + 2 <= k) { row_times_block<2>(row, cols, X, k, v, out); v += 2; }
+        if (v < k) row_times_block<1>(row, cols, X, k, v, out);
+    }
+}
+
+// Y (rows x k) = A (rows x cols) * X (cols x k) за один проход по A.
+// Разбиение по блокам строк то же, что в allocate_first_touch.
+void multiply_batched(const double* A, int rows, int cols, const double* X, int k, double* Y) {
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < rows; i += BATCH_ROW_BLOCK) {
+        int block_rows = std::min(BATCH_ROW_BLOCK, rows - i);
+        row_block_times_batch(A + (size_t)i * cols, block_rows, cols, X, k, Y + (size_t)i * k);
+    }
+}
+
+// k = 1, 2, 4, ... max_batch: время пакета, ГБ/с (матрица + X + Y) и доля от измеренного пика STREAM
+int run_batched(int rows, int cols, int max_batch) {
+    select_dot_kernels();
+    double peak = measure_stream_triad();
+    std::cout << "STREAM triad peak: " << peak << " GB/s (" << omp_get_max_threads() << " threads)\n";
+    std::unique_ptr<double[]> A = allocate_first_touch(rows, cols, 1);
+    std::cout << "Matrix " << rows << "x" << cols << " (" << (double)rows * cols * sizeof(double) / (1024.0 * 1024.0)
+              << " MB), first-touch initialised\n";
+
+    bool correct = true;
+    for (int k = 1; k <= max_batch; k *= 2) {
+        std::unique_ptr<double[]> X = allocate_first_touch(cols, k, 2);
+        std::unique_ptr<double[]> Y(new double[(size_t)rows * k]);
+        multiply_batched(A.get(), rows, cols, X.get(), k, Y.get());
+
+        // Несколько строк сверяются с обычным скалярным произведением для каждого вектора
+        for (int i = 0; i < rows; i += std::max(1, rows / 16)) {
+            for (int v = 0; v < k; ++v) {
+                double expected = 0.0;
+                for (int j = 0; j < cols; ++j) expected += A[(size_t)i * cols + j] * X[(size_t)j * k + v];
+                if (std::abs(expected - Y[(size_t)i * k + v]) > 1e-9 * std::abs(expected)) correct = false;
+            }
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int r = 0; r < BATCH_REPEAT; ++r) {
+            multiply_batched(A.get(), rows, cols, X.get(), k, Y.get());
+        }
+        double time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count() / BATCH_REPEAT;
+        double bytes = ((double)rows * cols + (double)cols * k + (double)rows * k) * sizeof(double);
+        std::cout << "k = " << k << ": " << time << " s per batch, " << time / k << " s per vector, "
+                  << bytes / time / 1e9 << " GB/s (" << 100.0 * bytes / time / 1e9 / peak << "% of STREAM), "
+                  << 2.0 * rows * cols * k / time / 1e9 << " GFLOP/s\n";
+    }
+    std::cout << "Batched results match: " << (correct ? "Yes" : "No") << "\n";
+    return correct ? 0 : 1;
+}
+
+// y = A * x для матрицы в файле: полосы по panel строк копируются из отображения (чтение),
+// затем умножаются параллельно (счёт). Пока считается полоса, ядро по MADV_WILLNEED читает следующую.
+// Недостающий файл создаётся rows x cols по хешу координат, вектор x всегда строится в памяти
+int run_out_of_core(const std::string& path, int rows, int cols, int panel) {
+    MappedMatrix A;
+    std::string error;
+    if (!open_or_generate(A, path, rows, cols, 1, error)) {
+        std::cerr << error << "\n";
+        return 1;
+    }
+    rows = (int)A.rows;
+    cols = (int)A.cols;
+    select_dot_kernels();
+
+    std::vector<double> x(cols), y(rows);
+    for (int j = 0; j < cols; ++j) x[j] = matrix_element(2, j, 0);
+    std::vector<double> buffer((size_t)std::min(panel, rows) * cols);
+    double io_time = 0.0, compute_time = 0.0;
+    A.advise(0, std::min(panel, rows), MADV_WILLNEED);
+    for (int i0 = 0; i0 < rows; i0 += panel) {
+        int count = std::min(panel, rows - i0);
+        A.advise(i0 + count, std::min(panel, rows - i0 - count), MADV_WILLNEED);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        std::memcpy(buffer.data(), A.row(i0), (size_t)count * cols * sizeof(double));
+        A.advise(i0, count, MADV_DONTNEED);
+        io_time += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+        start = std::chrono::high_resolution_clock::now();
+        #pragma omp parallel for schedule(static)
+        for (int r = 0; r < count; ++r) {
+            y[i0 + r] = dot<double, double>(&buffer[(size_t)r * cols], x.data(), cols);
+        }
+        compute_time += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    double bytes = (double)rows * cols * sizeof(double);
+    std::cout << "Out-of-core " << rows << "x" << cols << " (" << bytes / (1024.0 * 1024.0) << " MB), panel " << panel << " rows\n";
+    std::cout << "I/O: " << io_time << " s, " << bytes / io_time / 1e9 << " GB/s\n";
+    std::cout << "Compute: " << compute_time << " s, " << bytes / compute_time / 1e9 << " GB/s, "
+              << 2.0 * rows * cols / compute_time / 1e9 << " GFLOP/s\n";
+
+    bool correct = true;
+    for (int i = 0; i < rows; i += std::max(1, rows / 16)) {
+        double expected = 0.0;
+        for (int j = 0; j < cols; ++j) expected += A.row(i)[j] * x[j];
+        if (std::abs(expected - y[i]) > 1e-9 * std::abs(expected)) correct = false;
+    }
+    std::cout << "Results match: " << (correct ? "Yes" : "No") << "\n";
+    return correct ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    std::string precision;
+    std::string mtx_path, matrix_path;
+    bool tune = false;
+    tune_cache.path = default_tune_path("matrix_vector_openmp");
+    int panel = OOC_PANEL;
+    int sparse_size = 0, nnz_per_row = 16, repeat = SPMV_REPEAT;
+    int max_batch = 0, batch_rows = BATCH_ROWS, batch_cols = BATCH_COLS;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--precision" && has_value) {
+            precision = argv[++i];
+        } else if (arg == "--mtx" && has_value) {
+            mtx_path = argv[++i];
+        } else if (arg == "--sparse" && has_value) {
+            sparse_size = std::atoi(argv[++i]);
+        } else if (arg == "--nnz-per-row" && has_value) {
+            nnz_per_row = std::atoi(argv[++i]);
+        } else if (arg == "--repeat" && has_value) {
+            repeat = std::atoi(argv[++i]);
+        } else if (arg == "--batch" && has_value) {
+            max_batch = std::atoi(argv[++i]);
+        } else if (arg == "--rows" && has_value) {
+            batch_rows = std::atoi(argv[++i]);
+        } else if (arg == "--cols" && has_value) {
+            batch_cols = std::atoi(argv[++i]);
+        } else if (arg == "--matrix" && has_value) {
+            matrix_path = argv[++i];
+        } else if (arg == "--panel" && has_value) {
+            panel = std::atoi(argv[++i]);
+        } else if (arg == "--tune") {
+            tune = true;
+        } else if (arg == "--tune-file" && has_value) {
+            tune_cache.path = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--precision double|float|bf16|int8|all]\n"
+                      << "       [--mtx FILE.mtx | --sparse N [--nnz-per-row K]] [--repeat R]\n"
+                      << "       [--batch MAX_K [--rows R] [--cols C]]\n"
+                      << "       [--matrix FILE.bin [--rows R] [--cols C] [--panel ROWS]] (out-of-core)\n"
+                      << "       [--tune] [--tune-file FILE] (dense and --sparse/--mtx)\n";
+            return 1;
+        }
+    }
+    if (repeat < 1 || nnz_per_row < 1 || batch_rows < 1 || batch_cols < 1 || panel < 1) {
+        std::cerr << "Repeat count, nonzeros per row, dimensions and panel must be positive\n";
+        return 1;
+    }
+
+    // Рабочие запуски берут подобранные настройки из файла машины и не тюнят заново
+    if (tune_cache.load()) {
+        std::cout << "Loaded " << tune_cache.size() << " tuned configurations from " << tune_cache.path << "\n";
+    }
+
+    if (max_batch > 0) {
+        return run_batched(batch_rows, batch_cols, max_batch);
+    }
+    if (!matrix_path.empty()) {
+        return run_out_of_core(matrix_path, batch_rows, batch_cols, panel);
+    }
+
+    if (!mtx_path.empty() || sparse_size > 0) {
+        CsrMatrix csr;
+        if (!mtx_path.empty()) {
+            std::string error;
+            if (!read_matrix_market(mtx_path, csr, error)) {
+                std::cerr << "Failed to read " << mtx_path << ": " << error << "\n";
+                return 1;
+            }
+        } else {
+            generate_sparse(csr, sparse_size, nnz_per_row);
+        }
+        int status = run_sparse(csr, repeat, tune);
+        if (tune && !tune_cache.save()) {
+            std::cerr << "Failed to write " << tune_cache.path << "\n";
+            return 1;
+        }
+        return status;
+    }
+    if (!precision.empty() && precision != "double" && precision != "float" && precision != "bf16"
+        && precision != "int8" && precision != "all") {
+        std::cerr << "Unknown precision: " << precision << "\n";
+        return 1;
+    }
+
     std::vector<std::vector<double>> matrix;
     std::vector<double> vector, result_seq, result_par;
     initialize_matrix_vector(matrix, vector);
 
+    if (tune) {
+        TuneConfig best = autotune("dense", tune_cache.lookup("dense", ROWS, TuneConfig()), {}, [&](const TuneConfig& config) {
+            for (int r = 0; r < REPEAT; ++r) multiply_parallel(matrix, vector, result_par, config);
+        });
+        tune_cache.store("dense", ROWS, best);
+        if (!tune_cache.save()) {
+            std::cerr << "Failed to write " << tune_cache.path << "\n";
+            return 1;
+        }
+    }
+
     auto start_seq = std::chrono::high_resolution_clock::now();
     multiply_sequential(matrix, vector, result_seq);
     auto end_seq = std::chrono::high_resolution_clock::now();
@@ -71,5 +680,17 @@ int main() {
     }
     std::cout << "Results match: " << (correct ? "Yes" : "No") << "\n";
 
+    if (!precision.empty()) {
+        select_dot_kernels();
+        std::cout << "Typed kernels (" << (use_avx2 ? "avx2" : "scalar") << "), error against the double sequential result:\n";
+        std::vector<double> flat((size_t)ROWS * COLS);
+        for (int i = 0; i < ROWS; ++i) std::copy(matrix[i].begin(), matrix[i].end(), flat.begin() + (size_t)i * COLS);
+        bool all = precision == "all";
+        if (all || precision == "double") run_precision<double, double>("double", flat, vector, result_seq);
+        if (all || precision == "float") run_precision<float, float>("float", flat, vector, result_seq);
+        if (all || precision == "bf16") run_precision<bf16, float>("bf16/float", flat, vector, result_seq);
+        if (all || precision == "int8") run_precision<int8_t, int32_t>("int8/int32", flat, vector, result_seq);
+    }
+
     return 0;
 }
\ No newline at end of file
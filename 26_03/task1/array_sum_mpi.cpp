@@ -2,20 +2,38 @@
 #include <vector>
 #include <random>
 #include <chrono>
+#include <string>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include <cstdint>
 #include <mpi.h>
+#include "../../common/deterministic_sum.h"
 
 #define SIZE 10000000
 
-void initialize_array(std::vector<double>& arr) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<> dis(0.0, 10.0);
-    arr.resize(SIZE);
-    for (int i = 0; i < SIZE; ++i) {
-        arr[i] = dis(gen);
+// Счётчиковый генератор (SplitMix64 от seed и номера элемента): i-й элемент не зависит от остальных,
+// поэтому любой ранг строит свой кусок глобального массива сам, и массив одинаков при любом числе процессов
+static inline double array_element(uint64_t seed, int64_t i) {
+    uint64_t z = seed * 0xD1B54A32D192ED03ULL + (uint64_t)i * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    return (z >> 11) * (10.0 / 9007199254740992.0);
+}
+
+// Элементы [first, first + count) глобального массива
+void initialize_slice(std::vector<double>& arr, uint64_t seed, int first, int count) {
+    arr.resize(count);
+    for (int i = 0; i < count; ++i) {
+        arr[i] = array_element(seed, first + i);
     }
 }
 
+void initialize_array(std::vector<double>& arr, uint64_t seed) {
+    initialize_slice(arr, seed, 0, SIZE);
+}
+
 double sum_sequential(const std::vector<double>& arr) {
     double sum = 0.0;
     for (int i = 0; i < SIZE; ++i) {
@@ -24,6 +42,46 @@ double sum_sequential(const std::vector<double>& arr) {
     return sum;
 }
 
+void block_range(int n, int parts, int index, int* start, int* count) {
+    *count = n / parts + (index < n % parts);
+    *start = index * (n / parts) + (index < n % parts ? index : n % parts);
+}
+
+// Куски рангов - целые блоки DET_BLOCK: ранг r владеет элементами [*first, *first + *count)
+void slice_range(int size, int rank, int* first, int* count) {
+    int blocks = (SIZE + DET_BLOCK - 1) / DET_BLOCK;
+    int first_block, block_count;
+    block_range(blocks, size, rank, &first_block, &block_count);
+    *first = std::min(SIZE, first_block * DET_BLOCK);
+    *count = std::min(SIZE, (first_block + block_count) * DET_BLOCK) - *first;
+}
+
+// Частичные суммы блоков своего куска (slice) собираются на rank 0 (по два double на блок) и там сводятся деревом;
+// результат побитово одинаков при любом числе процессов
+double sum_deterministic(const std::vector<double>& slice, int rank, int size) {
+    int blocks = (SIZE + DET_BLOCK - 1) / DET_BLOCK;
+    int first_block, block_count;
+    block_range(blocks, size, rank, &first_block, &block_count);
+    std::vector<CompensatedSum> local(block_count);
+    for (int b = 0; b < block_count; ++b) {
+        int first = b * DET_BLOCK;
+        local[b] = block_sum(&slice[first], std::min(DET_BLOCK, (int)slice.size() - first));
+    }
+
+    std::vector<CompensatedSum> parts(rank == 0 ? blocks : 0);
+    std::vector<int> counts(size), displs(size);
+    for (int r = 0; r < size; ++r) {
+        block_range(blocks, size, r, &displs[r], &counts[r]);
+        counts[r] *= 2;
+        displs[r] *= 2;
+    }
+    MPI_Gatherv(local.data(), 2 * block_count, MPI_DOUBLE, parts.data(), counts.data(), displs.data(),
+                MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    if (rank != 0) return 0.0;
+    CompensatedSum total = tree_reduce(parts);
+    return total.sum + total.error;
+}
+
 int main(int argc, char** argv) {
     MPI_Init(&argc, &argv);
 
@@ -31,12 +89,36 @@ int main(int argc, char** argv) {
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
 
-    std::vector<double> arr;
+    // С одинаковым --seed массив (и вывод воспроизводимой суммы) одинаков при любом -np и в обоих режимах
+    uint64_t seed = std::random_device()();
+    std::string mode = "scatter";
+    bool valid = true;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--seed" && has_value) {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--mode" && has_value) {
+            mode = argv[++i];
+        } else {
+            valid = false;
+        }
+    }
+    if (mode != "scatter" && mode != "local") valid = false;
+    if (!valid) {
+        if (rank == 0) std::cerr << "Usage: " << argv[0] << " [--seed N] [--mode scatter|local]\n";
+        MPI_Finalize();
+        return 1;
+    }
+    MPI_Bcast(&seed, 1, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+
+    // Полный массив есть только на rank 0 - для последовательного эталона и как источник в режиме scatter
+    std::vector<double> arr, slice;
     double seq_sum = 0.0, par_sum = 0.0;
     double seq_time = 0.0, par_time = 0.0;
 
     if (rank == 0) {
-        initialize_array(arr);
+        initialize_array(arr, seed);
         auto start_seq = std::chrono::high_resolution_clock::now();
         seq_sum = sum_sequential(arr);
         auto end_seq = std::chrono::high_resolution_clock::now();
@@ -45,32 +127,67 @@ int main(int argc, char** argv) {
         std::cout << "Sequential time: " << seq_time << " seconds\n";
     }
 
-    if (rank == 0) {
-        MPI_Bcast(arr.data(), SIZE, MPI_DOUBLE, 0, MPI_COMM_WORLD);
-    } else {
-        arr.resize(SIZE);
-        MPI_Bcast(arr.data(), SIZE, MPI_DOUBLE, 0, MPI_COMM_WORLD);
-    }
-
-    int chunk_size = SIZE / size;
-    int start = rank * chunk_size;
-    int end = (rank == size - 1) ? SIZE : start + chunk_size;
+    int first, count;
+    slice_range(size, rank, &first, &count);
+    std::vector<int> counts(size), displs(size);
+    for (int r = 0; r < size; ++r) slice_range(size, r, &displs[r], &counts[r]);
 
+    // par_time включает доставку данных: MPI_Scatterv кусков с rank 0 или генерацию своего куска на месте
+    MPI_Barrier(MPI_COMM_WORLD);
     auto start_par = std::chrono::high_resolution_clock::now();
+    if (mode == "scatter") {
+        slice.resize(count);
+        MPI_Scatterv(arr.data(), counts.data(), displs.data(), MPI_DOUBLE, slice.data(), count, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    } else {
+        initialize_slice(slice, seed, first, count);
+    }
+    double data_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start_par).count();
     double local_sum = 0.0;
-    for (int i = start; i < end; ++i) {
-        local_sum += arr[i];
+    for (int i = 0; i < count; ++i) {
+        local_sum += slice[i];
     }
     MPI_Reduce(&local_sum, &par_sum, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
     auto end_par = std::chrono::high_resolution_clock::now();
     par_time = std::chrono::duration<double>(end_par - start_par).count();
 
+    double max_data_time;
+    MPI_Reduce(&data_time, &max_data_time, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
     if (rank == 0) {
+        double moved = mode == "scatter" ? (double)(SIZE - counts[0]) * sizeof(double) : 0.0;
         std::cout << "Parallel sum: " << par_sum << "\n";
-        std::cout << "Parallel time (" << size << " processes): " << par_time << " seconds\n";
-        std::cout << "Results match: " << (std::abs(seq_sum - par_sum) < 1e-6 ? "Yes" : "No") << "\n";
+        std::cout << "Parallel time (" << size << " processes, " << mode << "): " << par_time << " seconds, of which "
+                  << (mode == "scatter" ? "scatter " : "local generation ") << max_data_time << " s\n";
+        std::cout << "Input data sent: " << moved / (1024.0 * 1024.0) << " MB, largest slice "
+                  << (double)*std::max_element(counts.begin(), counts.end()) * sizeof(double) / (1024.0 * 1024.0) << " MB per rank\n";
+        // Ошибка округления обычной суммы растёт с длиной массива, поэтому допуск относительный
+        std::cout << "Results match: " << (std::abs(seq_sum - par_sum) <= 1e-10 * std::abs(seq_sum) ? "Yes" : "No") << "\n";
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    auto start_det = std::chrono::high_resolution_clock::now();
+    double det_sum = sum_deterministic(slice, rank, size);
+    double det_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start_det).count();
+
+    int identical = 1;
+    if (rank == 0) {
+        // Эталон - тот же алгоритм на одном процессе
+        std::vector<CompensatedSum> parts;
+        for (int first = 0; first < SIZE; first += DET_BLOCK) {
+            parts.push_back(block_sum(&arr[first], std::min(DET_BLOCK, SIZE - first)));
+        }
+        CompensatedSum reference = tree_reduce(parts);
+        identical = reference.sum + reference.error == det_sum;
+
+        std::cout.precision(17);
+        std::cout << "Deterministic sum: " << det_sum << " (" << std::hexfloat << det_sum << std::defaultfloat << ")\n";
+        std::cout.precision(6);
+        std::cout << "Deterministic time (" << size << " processes): " << det_time << " seconds ("
+                  << det_time / (par_time - data_time) << "x the plain sum and reduce, data delivery excluded)\n";
+        std::cout << "Plain reductions differ from it by: sequential " << std::abs(seq_sum - det_sum)
+                  << ", parallel " << std::abs(par_sum - det_sum) << "\n";
+        std::cout << "Bit-identical to the single-process result: " << (identical ? "Yes" : "No") << "\n";
     }
 
     MPI_Finalize();
-    return 0;
+    return identical ? 0 : 1;
 }
\ No newline at end of file
@@ -2,32 +2,134 @@
 #include <vector>
 #include <random>
 #include <chrono>
+#include <string>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <type_traits>
+#include <cerrno>
 #include <mpi.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../../common/matrix_file.h"
+#include "../../common/precision.h"
 
 #define M 1000
 #define N 1000
 #define P 1000
+#define PANEL 128
+#define CHECK_SAMPLES 64
 
-using Matrix = std::vector<std::vector<double>>;
+#define CHUNK_ROWS 16
+
+// Матрица rows x cols хранится одним непрерывным блоком построчно: элемент (i, j) - mat[i * cols + j]
+using Matrix = std::vector<double>;
 
 void initialize_matrix(Matrix& mat, int rows, int cols) {
     std::random_device rd;
     std::mt19937 gen(rd());
     std::uniform_real_distribution<> dis(0.0, 10.0);
-    mat.resize(rows, std::vector<double>(cols));
+    mat.resize((size_t)rows * cols);
     for (int i = 0; i < rows; ++i) {
         for (int j = 0; j < cols; ++j) {
-            mat[i][j] = dis(gen);
+            mat[(size_t)i * cols + j] = dis(gen);
         }
     }
 }
 
-void multiply_sequential(const Matrix& A, const Matrix& B, Matrix& C) {
-    for (int i = 0; i < M; ++i) {
-        for (int j = 0; j < P; ++j) {
-            C[i][j] = 0.0;
-            for (int k = 0; k < N; ++k) {
-                C[i][j] += A[i][k] * B[k][j];
+void multiply_sequential(const Matrix& A, const Matrix& B, Matrix& C, int m, int n, int p) {
+    for (int i = 0; i < m; ++i) {
+        for (int j = 0; j < p; ++j) {
+            double sum = 0.0;
+            for (int k = 0; k < n; ++k) {
+                sum += A[(size_t)i * n + k] * B[(size_t)k * p + j];
+            }
+            C[(size_t)i * p + j] = sum;
+        }
+    }
+}
+
+// bf16 передаётся как есть, 16-битными словами
+template<typename T> MPI_Datatype mpi_type();
+template<> MPI_Datatype mpi_type<double>() { return MPI_DOUBLE; }
+template<> MPI_Datatype mpi_type<float>() { return MPI_FLOAT; }
+template<> MPI_Datatype mpi_type<bf16>() { return MPI_UINT16_T; }
+template<> MPI_Datatype mpi_type<int8_t>() { return MPI_INT8_T; }
+template<> MPI_Datatype mpi_type<int32_t>() { return MPI_INT32_T; }
+
+#if SIMD_KERNELS
+// c[0..p) += a * b[0..p) со строкой b в типе хранения: при -O2 компилятор этот цикл не векторизует,
+// поэтому для каждой пары типов есть ядро AVX2 с расширением b до типа накопления
+__attribute__((target("avx2,fma")))
+void axpy_avx2(double a, const double* b, double* c, int p) {
+    __m256d va = _mm256_set1_pd(a);
+    int j = 0;
+    for (; j + 8 <= p; j += 8) {
+        _mm256_storeu_pd(c + j, _mm256_fmadd_pd(va, _mm256_loadu_pd(b + j), _mm256_loadu_pd(c + j)));
+        _mm256_storeu_pd(c + j + 4, _mm256_fmadd_pd(va, _mm256_loadu_pd(b + j + 4), _mm256_loadu_pd(c + j + 4)));
+    }
+    for (; j < p; ++j) c[j] += a * b[j];
+}
+
+__attribute__((target("avx2,fma")))
+void axpy_avx2(float a, const float* b, float* c, int p) {
+    __m256 va = _mm256_set1_ps(a);
+    int j = 0;
+    for (; j + 16 <= p; j += 16) {
+        _mm256_storeu_ps(c + j, _mm256_fmadd_ps(va, _mm256_loadu_ps(b + j), _mm256_loadu_ps(c + j)));
+        _mm256_storeu_ps(c + j + 8, _mm256_fmadd_ps(va, _mm256_loadu_ps(b + j + 8), _mm256_loadu_ps(c + j + 8)));
+    }
+    for (; j < p; ++j) c[j] += a * b[j];
+}
+
+// bf16 расширяется до float сдвигом на 16 бит
+__attribute__((target("avx2,fma")))
+void axpy_avx2(float a, const bf16* b, float* c, int p) {
+    __m256 va = _mm256_set1_ps(a);
+    int j = 0;
+    for (; j + 8 <= p; j += 8) {
+        __m256i wb = _mm256_slli_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(b + j))), 16);
+        _mm256_storeu_ps(c + j, _mm256_fmadd_ps(va, _mm256_castsi256_ps(wb), _mm256_loadu_ps(c + j)));
+    }
+    for (; j < p; ++j) c[j] += a * from_bf16(b[j]);
+}
+
+// int8 расширяется сразу до int32, произведение и сумма точные
+__attribute__((target("avx2,fma")))
+void axpy_avx2(int32_t a, const int8_t* b, int32_t* c, int p) {
+    __m256i va = _mm256_set1_epi32(a);
+    int j = 0;
+    for (; j + 8 <= p; j += 8) {
+        __m256i wb = _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i*)(b + j)));
+        __m256i vc = _mm256_loadu_si256((const __m256i*)(c + j));
+        _mm256_storeu_si256((__m256i*)(c + j), _mm256_add_epi32(vc, _mm256_mullo_epi32(va, wb)));
+    }
+    for (; j < p; ++j) c[j] += a * b[j];
+}
+#endif
+
+// Строки A (rows x n) на B (n x p); порядок суммирования по k тот же, что в multiply_sequential.
+// Внутренний цикл по j идёт подряд по памяти; ядро AVX2 выбирается при запуске (select_dot_kernels)
+template<typename T, typename Acc>
+void multiply_rows(const T* A, const T* B, Acc* C, int rows, int n, int p) {
+    for (int i = 0; i < rows; ++i) {
+        Acc* c = C + (size_t)i * p;
+        std::fill(c, c + p, Acc(0));
+        for (int k = 0; k < n; ++k) {
+            Acc a = widen<Acc>(A[(size_t)i * n + k]);
+            const T* b = B + (size_t)k * p;
+#if SIMD_KERNELS
+            if (use_avx2) {
+                axpy_avx2(a, b, c, p);
+                continue;
+            }
+#endif
+            for (int j = 0; j < p; ++j) {
+                c[j] += a * widen<Acc>(b[j]);
             }
         }
     }
@@ -36,128 +138,504 @@ void multiply_sequential(const Matrix& A, const Matrix& B, Matrix& C) {
 void print_matrix_part(const Matrix& mat, int rows, int cols, int limit = 5) {
     for (int i = 0; i < std::min(rows, limit); ++i) {
         for (int j = 0; j < std::min(cols, limit); ++j) {
-            std::cout << mat[i][j] << " ";
+            std::cout << mat[(size_t)i * cols + j] << " ";
         }
         std::cout << "\n";
     }
 }
 
-int main(int argc, char** argv) {
-    MPI_Init(&argc, &argv);
+void block_range(int n, int parts, int index, int* start, int* count) {
+    *count = n / parts + (index < n % parts);
+    *start = index * (n / parts) + (index < n % parts ? index : n % parts);
+}
 
-    int rank, size;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &size);
+double seconds_since(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
 
-    Matrix A, B, C_seq, C_par;
-    double seq_time = 0.0, par_time = 0.0;
+// Строки rank 0 раздаёт порциями по chunk_rows: раунд c - это MPI_Iscatterv c-й порции каждого ранга,
+// тип "строка A" задан производным типом, поэтому счётчики и смещения считаются в строках.
+// Все раунды выставляются сразу, ранг умножает порцию c, пока приходят следующие, и тут же отдаёт
+// её результат через MPI_Igatherv прямо в плоскую C на ранге 0.
+// Пересылаются и перемножаются A и B в типе T, C собирается в Acc; эталон - последовательное произведение в double.
+template<typename T, typename Acc>
+void run_rows(int rank, int size, int m, int n, int p, int chunk_rows, const char* precision) {
+    Matrix A_ref, B_ref, C_seq;
+    std::vector<T> A, B((size_t)n * p);
+    std::vector<Acc> C;
+    double seq_time = 0.0, scale_a = 1.0, scale_b = 1.0;
 
     if (rank == 0) {
-        initialize_matrix(A, M, N);
-        initialize_matrix(B, N, P);
-        initialize_matrix(C_seq, M, P);
-        initialize_matrix(C_par, M, P);
+        initialize_matrix(A_ref, m, n);
+        initialize_matrix(B_ref, n, p);
+        scale_a = storage_scale<T>(A_ref);
+        scale_b = storage_scale<T>(B_ref);
+        A = encode_all<T>(A_ref, scale_a);
+        B = encode_all<T>(B_ref, scale_b);
+        C.resize((size_t)m * p);
+        C_seq.resize((size_t)m * p);
 
         auto start_seq = std::chrono::high_resolution_clock::now();
-        multiply_sequential(A, B, C_seq);
-        auto end_seq = std::chrono::high_resolution_clock::now();
-        seq_time = std::chrono::duration<double>(end_seq - start_seq).count();
+        multiply_sequential(A_ref, B_ref, C_seq, m, n, p);
+        seq_time = seconds_since(start_seq);
         std::cout << "Sequential time: " << seq_time << " seconds\n";
         std::cout << "Sequential result (first 5x5):\n";
-        print_matrix_part(C_seq, M, P);
+        print_matrix_part(C_seq, m, p);
+    }
+
+    std::vector<int> row_start(size), row_count(size);
+    int rounds = 0;
+    for (int r = 0; r < size; ++r) {
+        block_range(m, size, r, &row_start[r], &row_count[r]);
+        rounds = std::max(rounds, (row_count[r] + chunk_rows - 1) / chunk_rows);
+    }
+    auto chunk = [&](int r, int c) { return std::max(0, std::min(chunk_rows, row_count[r] - c * chunk_rows)); };
+
+    // Массивы счётчиков и смещений неблокирующих коллективов должны жить до их завершения
+    std::vector<std::vector<int>> counts(rounds, std::vector<int>(size)), displs(rounds, std::vector<int>(size));
+    for (int c = 0; c < rounds; ++c) {
+        for (int r = 0; r < size; ++r) {
+            counts[c][r] = chunk(r, c);
+            displs[c][r] = row_start[r] + c * chunk_rows;
+        }
     }
 
-    std::vector<double> B_flat(N * P);
+    MPI_Datatype a_row, c_row;
+    MPI_Type_contiguous(n, mpi_type<T>(), &a_row);
+    MPI_Type_contiguous(p, mpi_type<Acc>(), &c_row);
+    MPI_Type_commit(&a_row);
+    MPI_Type_commit(&c_row);
+
+    // Ранг 0 читает свои строки прямо из A и пишет прямо в C (MPI_IN_PLACE), остальным нужна только своя полоса
+    int rows = row_count[rank];
+    std::vector<T> local_A(rank == 0 ? 0 : (size_t)rows * n);
+    std::vector<Acc> local_C(rank == 0 ? 0 : (size_t)rows * p);
+    const T* my_A = (rank == 0) ? A.data() + (size_t)row_start[0] * n : local_A.data();
+    Acc* my_C = (rank == 0) ? C.data() + (size_t)row_start[0] * p : local_C.data();
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    auto start_par = std::chrono::high_resolution_clock::now();
+    double comm_time = 0.0, compute_time = 0.0, overlap_time = 0.0;
+
+    MPI_Request b_request;
+    MPI_Ibcast(B.data(), n * p, mpi_type<T>(), 0, MPI_COMM_WORLD, &b_request);
+    std::vector<MPI_Request> scatter(rounds), gather(rounds, MPI_REQUEST_NULL);
+    for (int c = 0; c < rounds; ++c) {
+        int mine = chunk(rank, c);
+        void* recv = (rank == 0) ? MPI_IN_PLACE : (mine ? (void*)(local_A.data() + (size_t)c * chunk_rows * n) : nullptr);
+        MPI_Iscatterv(A.data(), counts[c].data(), displs[c].data(), a_row,
+                      recv, mine, a_row, 0, MPI_COMM_WORLD, &scatter[c]);
+    }
+
+    auto wait_start = std::chrono::high_resolution_clock::now();
+    MPI_Wait(&b_request, MPI_STATUS_IGNORE);
+    comm_time += seconds_since(wait_start);
+
+    for (int c = 0; c < rounds; ++c) {
+        wait_start = std::chrono::high_resolution_clock::now();
+        MPI_Wait(&scatter[c], MPI_STATUS_IGNORE);
+        comm_time += seconds_since(wait_start);
+
+        // Перекрытие: счёт порции, пока ещё идут следующие раунды раздачи или сбор предыдущих
+        int later_done = 1, earlier_done = 1;
+        if (c + 1 < rounds) MPI_Testall(rounds - c - 1, &scatter[c + 1], &later_done, MPI_STATUSES_IGNORE);
+        if (c > 0) MPI_Testall(c, gather.data(), &earlier_done, MPI_STATUSES_IGNORE);
+
+        int mine = chunk(rank, c);
+        auto compute_start = std::chrono::high_resolution_clock::now();
+        multiply_rows(my_A + (size_t)c * chunk_rows * n, B.data(), my_C + (size_t)c * chunk_rows * p, mine, n, p);
+        double elapsed = seconds_since(compute_start);
+        compute_time += elapsed;
+        if (!later_done || !earlier_done) overlap_time += elapsed;
+
+        const void* send = (rank == 0) ? MPI_IN_PLACE : (mine ? (const void*)(my_C + (size_t)c * chunk_rows * p) : nullptr);
+        MPI_Igatherv(send, mine, c_row, C.data(), counts[c].data(), displs[c].data(), c_row,
+                     0, MPI_COMM_WORLD, &gather[c]);
+    }
+
+    wait_start = std::chrono::high_resolution_clock::now();
+    MPI_Waitall(rounds, gather.data(), MPI_STATUSES_IGNORE);
+    comm_time += seconds_since(wait_start);
+    double par_time = seconds_since(start_par);
+
+    double times[4] = { par_time, comm_time, overlap_time, compute_time }, max_times[4];
+    MPI_Reduce(times, max_times, 4, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Type_free(&a_row);
+    MPI_Type_free(&c_row);
+
     if (rank == 0) {
-        for (int i = 0; i < N; ++i) {
-            for (int j = 0; j < P; ++j) {
-                B_flat[i * P + j] = B[i][j];
-            }
+        // Объём пересылок: B всем рабочим, строки A и строки C рабочих рангов
+        double bytes = (double)(size - 1) * n * p * sizeof(T) + (double)(m - row_count[0]) * (n * sizeof(T) + p * sizeof(Acc));
+        std::cout << "Precision: " << precision << " (" << (use_avx2 ? "avx2" : "scalar") << " kernels), " << bytes / (1024.0 * 1024.0) << " MB moved between ranks\n";
+        std::cout << "Parallel time (" << size << " processes, including communication): " << max_times[0] << " seconds ("
+                  << 2.0 * m * n * p / max_times[0] / 1e9 << " GFLOP/s)\n";
+        std::cout << "Max per rank: communication waits " << max_times[1] << " s, compute " << max_times[3]
+                  << " s (overlapped with transfers " << max_times[2] << " s), " << rounds << " rounds of "
+                  << chunk_rows << " rows\n";
+        Matrix C_par(C.size());
+        for (size_t i = 0; i < C.size(); ++i) C_par[i] = (double)C[i] * scale_a * scale_b;
+        std::cout << "Parallel result (first 5x5):\n";
+        print_matrix_part(C_par, m, p);
+        bool correct = true;
+        double max_diff = 0.0, max_value = 0.0;
+        for (size_t i = 0; i < C_par.size(); ++i) {
+            if (std::abs(C_seq[i] - C_par[i]) > 1e-6) correct = false;
+            max_diff = std::max(max_diff, std::abs(C_seq[i] - C_par[i]));
+            max_value = std::max(max_value, std::abs(C_seq[i]));
         }
+        // Поэлементный допуск 1e-6 имеет смысл только для double, для остальных типов важна относительная ошибка
+        if (std::is_same<T, double>::value) std::cout << "Results match: " << (correct ? "Yes" : "No") << "\n";
+        std::cout << "Max relative error against double: " << (max_value > 0.0 ? max_diff / max_value : max_diff) << "\n";
     }
-    MPI_Bcast(B_flat.data(), N * P, MPI_DOUBLE, 0, MPI_COMM_WORLD);
-    if (rank != 0) {
-        B.resize(N, std::vector<double>(P));
-        for (int i = 0; i < N; ++i) {
-            for (int j = 0; j < P; ++j) {
-                B[i][j] = B_flat[i * P + j];
-            }
+}
+
+template void run_rows<double, double>(int, int, int, int, int, int, const char*);
+template void run_rows<float, float>(int, int, int, int, int, int, const char*);
+template void run_rows<bf16, float>(int, int, int, int, int, int, const char*);
+template void run_rows<int8_t, int32_t>(int, int, int, int, int, int, const char*);
+
+// Панель SUMMA: столбцы k0..k0+width A (и те же строки B) лежат целиком в блоке одного столбца (строки) решётки
+struct Panel {
+    int k0;
+    int width;
+    int owner;
+};
+
+// SUMMA на решётке q x q: блоки A (m x n), B (n x p), C (m x p) распределены двумерно.
+// На шаге панели владелец рассылает свой кусок A по строке решётки и кусок B по столбцу,
+// следующая панель принимается (MPI_Ibcast), пока перемножается текущая.
+bool run_summa(int rank, int size, int m, int n, int p, int panel) {
+    int q = (int)std::lround(std::sqrt((double)size));
+    if (q * q != size) {
+        if (rank == 0) std::cerr << "SUMMA needs a square number of processes, got " << size << "\n";
+        return false;
+    }
+    int dims[2] = { q, q }, periods[2] = { 0, 0 }, coords[2];
+    MPI_Comm grid, row_comm, col_comm;
+    MPI_Cart_create(MPI_COMM_WORLD, 2, dims, periods, 0, &grid);
+    MPI_Cart_coords(grid, rank, 2, coords);
+    int my_row = coords[0], my_col = coords[1];
+    // В row_comm номер ранга равен столбцу решётки, в col_comm - строке
+    MPI_Comm_split(grid, my_row, my_col, &row_comm);
+    MPI_Comm_split(grid, my_col, my_row, &col_comm);
+
+    int row0, rows, col0, cols, k0_a, k_a, k0_b, k_b;
+    block_range(m, q, my_row, &row0, &rows);
+    block_range(p, q, my_col, &col0, &cols);
+    block_range(n, q, my_col, &k0_a, &k_a);
+    block_range(n, q, my_row, &k0_b, &k_b);
+
+    const uint64_t seed_a = 0x5EED0A, seed_b = 0x5EED0B;
+    std::vector<double> local_A((size_t)rows * k_a), local_B((size_t)k_b * cols), local_C((size_t)rows * cols, 0.0);
+    for (int i = 0; i < rows; ++i)
+        for (int k = 0; k < k_a; ++k) local_A[(size_t)i * k_a + k] = matrix_element(seed_a, row0 + i, k0_a + k);
+    for (int k = 0; k < k_b; ++k)
+        for (int j = 0; j < cols; ++j) local_B[(size_t)k * cols + j] = matrix_element(seed_b, k0_b + k, col0 + j);
+
+    std::vector<Panel> panels;
+    for (int owner = 0; owner < q; ++owner) {
+        int start, count;
+        block_range(n, q, owner, &start, &count);
+        for (int k = start; k < start + count; k += panel) {
+            panels.push_back({ k, std::min(panel, start + count - k), owner });
         }
     }
 
-    int rows_per_process = M / size;
-    int start_row = rank * rows_per_process;
-    int end_row = (rank == size - 1) ? M : start_row + rows_per_process;
-    std::vector<std::vector<double>> local_A(end_row - start_row, std::vector<double>(N));
+    std::vector<double> a_panel[2], b_panel[2];
+    for (int b = 0; b < 2; ++b) {
+        a_panel[b].resize((size_t)rows * panel);
+        b_panel[b].resize((size_t)panel * cols);
+    }
+    MPI_Request requests[2][2];
 
-    if (rank == 0) {
-        for (int i = start_row; i < end_row; ++i) {
-            for (int j = 0; j < N; ++j) {
-                local_A[i - start_row][j] = A[i][j];
+    auto post = [&](size_t s, int b) {
+        const Panel& pn = panels[s];
+        if (pn.owner == my_col) {
+            int offset = pn.k0 - k0_a;
+            for (int i = 0; i < rows; ++i) {
+                std::memcpy(&a_panel[b][(size_t)i * pn.width], &local_A[(size_t)i * k_a + offset], pn.width * sizeof(double));
             }
         }
-        for (int p = 1; p < size; ++p) {
-            int p_start = p * rows_per_process;
-            int p_end = (p == size - 1) ? M : p_start + rows_per_process;
-            for (int i = p_start; i < p_end; ++i) {
-                MPI_Send(A[i].data(), N, MPI_DOUBLE, p, 0, MPI_COMM_WORLD);
-            }
+        if (pn.owner == my_row) {
+            std::memcpy(b_panel[b].data(), &local_B[(size_t)(pn.k0 - k0_b) * cols], (size_t)pn.width * cols * sizeof(double));
         }
-    } else {
-        for (int i = 0; i < end_row - start_row; ++i) {
-            MPI_Recv(local_A[i].data(), N, MPI_DOUBLE, 0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        MPI_Ibcast(a_panel[b].data(), rows * pn.width, MPI_DOUBLE, pn.owner, row_comm, &requests[b][0]);
+        MPI_Ibcast(b_panel[b].data(), pn.width * cols, MPI_DOUBLE, pn.owner, col_comm, &requests[b][1]);
+    };
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    auto start = std::chrono::high_resolution_clock::now();
+    double comm_time = 0.0, compute_time = 0.0;
+    post(0, 0);
+    for (size_t s = 0; s < panels.size(); ++s) {
+        int b = s % 2;
+        auto wait_start = std::chrono::high_resolution_clock::now();
+        MPI_Waitall(2, requests[b], MPI_STATUSES_IGNORE);
+        comm_time += seconds_since(wait_start);
+        if (s + 1 < panels.size()) post(s + 1, 1 - b);
+
+        auto compute_start = std::chrono::high_resolution_clock::now();
+        int width = panels[s].width;
+        for (int i = 0; i < rows; ++i) {
+            double* c = &local_C[(size_t)i * cols];
+            for (int k = 0; k < width; ++k) {
+                double a = a_panel[b][(size_t)i * width + k];
+                const double* brow = &b_panel[b][(size_t)k * cols];
+                for (int j = 0; j < cols; ++j) {
+                    c[j] += a * brow[j];
+                }
+            }
         }
+        compute_time += seconds_since(compute_start);
     }
+    double par_time = seconds_since(start);
 
-    std::vector<std::vector<double>> local_C(end_row - start_row, std::vector<double>(P));
-    auto start_par = std::chrono::high_resolution_clock::now();
-    for (int i = 0; i < end_row - start_row; ++i) {
-        for (int j = 0; j < P; ++j) {
-            local_C[i][j] = 0.0;
-            for (int k = 0; k < N; ++k) {
-                local_C[i][j] += local_A[i][k] * B[k][j];
-            }
+    // Проверка без сбора матриц: часть элементов своего блока C каждый ранг пересчитывает из генератора
+    double max_error = 0.0;
+    int samples = std::min(CHECK_SAMPLES, rows * cols);
+    for (int t = 0; t < samples; ++t) {
+        int idx = (int)((int64_t)t * rows * cols / samples);
+        int i = idx / cols, j = idx % cols;
+        double expected = 0.0;
+        for (int k = 0; k < n; ++k) {
+            expected += matrix_element(seed_a, row0 + i, k) * matrix_element(seed_b, k, col0 + j);
         }
+        max_error = std::max(max_error, std::abs(expected - local_C[(size_t)i * cols + j]));
     }
-    auto end_par = std::chrono::high_resolution_clock::now();
-    par_time = std::chrono::duration<double>(end_par - start_par).count();
+
+    double local_bytes = (double)(local_A.size() + local_B.size() + local_C.size() + 2 * (a_panel[0].size() + b_panel[0].size()))
+                         * sizeof(double);
+    double times[3] = { par_time, comm_time, compute_time }, max_times[3];
+    double global_error = 0.0, max_bytes = 0.0;
+    MPI_Reduce(times, max_times, 3, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&max_error, &global_error, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&local_bytes, &max_bytes, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
 
     if (rank == 0) {
-        C_par.resize(M, std::vector<double>(P));
-        for (int i = start_row; i < end_row; ++i) {
-            for (int j = 0; j < P; ++j) {
-                C_par[i][j] = local_C[i - start_row][j];
-            }
+        std::cout << "SUMMA on " << q << "x" << q << " grid, A: " << m << "x" << n << ", B: " << n << "x" << p
+                  << ", " << panels.size() << " panels of up to " << panel << " columns\n";
+        std::cout << "Parallel time (" << size << " processes): " << max_times[0] << " seconds ("
+                  << 2.0 * m * n * p / max_times[0] / 1e9 << " GFLOP/s)\n";
+        std::cout << "Max per rank: waiting for panels " << max_times[1] << " s, compute " << max_times[2] << " s\n";
+        std::cout << "Max matrix memory per rank: " << max_bytes / (1024.0 * 1024.0) << " MB\n";
+        std::cout << "Results match (" << CHECK_SAMPLES << " sampled entries per rank): "
+                  << (global_error <= 1e-6 ? "Yes" : "No") << " (max abs error " << global_error << ")\n";
+    }
+
+    MPI_Comm_free(&row_comm);
+    MPI_Comm_free(&col_comm);
+    MPI_Comm_free(&grid);
+    return true;
+}
+
+// Умножение вне памяти над общими файлами (нужна общая файловая система): rank 0 создаёт недостающие A и B
+// и файл C, каждый ранг читает свои строки A полосами по panel и панели столбцов B из отображения и
+// следующую полосу подсказывает ядру через MADV_WILLNEED. Блоки C пишутся через pwrite в свой диапазон байт:
+// границы строк рангов не совпадают с границами страниц, и общая страница отображения MAP_SHARED на разных
+// узлах затёрла бы чужие строки. Время чтения/записи и счёта меряется отдельно, сообщается максимум по рангам
+bool run_file(int rank, int size, int m, int n, int p, int panel,
+              const std::string& path_a, const std::string& path_b, const std::string& path_c) {
+    MappedMatrix A, B, C;
+    std::string error;
+    int dims[3] = { m, n, p };
+    int ok = 1;
+    if (rank == 0) {
+        ok = open_or_generate(A, path_a, m, n, 1, error) && open_or_generate(B, path_b, n, p, 2, error);
+        if (ok && A.cols != B.rows) {
+            error = "inner dimensions of A and B differ";
+            ok = 0;
+        }
+        if (ok) {
+            dims[0] = (int)A.rows;
+            dims[1] = (int)A.cols;
+            dims[2] = (int)B.cols;
+            ok = C.create(path_c, dims[0], dims[2], error);
+            C.close();
+        }
+        if (!ok) std::cerr << error << "\n";
+    }
+    MPI_Bcast(&ok, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (!ok) return false;
+    MPI_Bcast(dims, 3, MPI_INT, 0, MPI_COMM_WORLD);
+    m = dims[0];
+    n = dims[1];
+    p = dims[2];
+    if (rank != 0) {
+        ok = A.open(path_a, false, error) && B.open(path_b, false, error);
+    }
+    int c_fd = ok ? ::open(path_c.c_str(), O_WRONLY) : -1;
+    if (ok && c_fd < 0) {
+        error = path_c + ": " + std::strerror(errno);
+        ok = 0;
+    }
+    if (!ok && rank != 0) std::cerr << "Rank " << rank << ": " << error << "\n";
+    int all_ok = 0;
+    MPI_Allreduce(&ok, &all_ok, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    if (!all_ok) {
+        if (c_fd >= 0) ::close(c_fd);
+        return false;
+    }
+
+    int row_start, row_count;
+    block_range(m, size, rank, &row_start, &row_count);
+    std::vector<double> b_panel((size_t)n * std::min(panel, p));
+    std::vector<double> a_panel((size_t)std::max(1, std::min(panel, row_count)) * n);
+    std::vector<double> c_panel((size_t)std::max(1, std::min(panel, row_count)) * std::min(panel, p));
+    double times[2] = { 0.0, 0.0 }, io_bytes = 0.0;  // чтение/запись, счёт
+    int written = 1;
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    auto start_total = std::chrono::high_resolution_clock::now();
+    A.advise(row_start, std::min(panel, row_count), MADV_WILLNEED);
+    for (int j0 = 0; j0 < p && row_count > 0; j0 += panel) {
+        int nb = std::min(panel, p - j0);
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int k = 0; k < n; ++k) {
+            std::memcpy(&b_panel[(size_t)k * nb], B.row(k) + j0, nb * sizeof(double));
         }
-        for (int p = 1; p < size; ++p) {
-            int p_start = p * rows_per_process;
-            int p_end = (p == size - 1) ? M : p_start + rows_per_process;
-            for (int i = p_start; i < p_end; ++i) {
-                MPI_Recv(C_par[i].data(), P, MPI_DOUBLE, p, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        times[0] += seconds_since(start);
+        io_bytes += (double)n * nb * sizeof(double);
+
+        for (int i0 = row_start; i0 < row_start + row_count; i0 += panel) {
+            int mb = std::min(panel, row_start + row_count - i0);
+            int next = i0 + panel < row_start + row_count ? i0 + panel : (j0 + panel < p ? row_start : row_start + row_count);
+            A.advise(next, std::min(panel, row_start + row_count - next), MADV_WILLNEED);
+
+            start = std::chrono::high_resolution_clock::now();
+            std::memcpy(a_panel.data(), A.row(i0), (size_t)mb * n * sizeof(double));
+            A.advise(i0, mb, MADV_DONTNEED);
+            times[0] += seconds_since(start);
+
+            start = std::chrono::high_resolution_clock::now();
+            multiply_rows<double, double>(a_panel.data(), b_panel.data(), c_panel.data(), mb, n, nb);
+            times[1] += seconds_since(start);
+
+            start = std::chrono::high_resolution_clock::now();
+            for (int r = 0; r < mb && written; ++r) {
+                off_t offset = MATRIX_HEADER_SIZE + ((off_t)(i0 + r) * p + j0) * (off_t)sizeof(double);
+                written = pwrite(c_fd, &c_panel[(size_t)r * nb], nb * sizeof(double), offset) == (ssize_t)(nb * sizeof(double));
             }
+            times[0] += seconds_since(start);
+            io_bytes += (double)mb * n * sizeof(double) + (double)mb * nb * sizeof(double);
         }
-    } else {
-        for (int i = 0; i < end_row - start_row; ++i) {
-            MPI_Send(local_C[i].data(), P, MPI_DOUBLE, 0, 0, MPI_COMM_WORLD);
+    }
+    // После close записанное видно другим узлам (close-to-open); на диск файл один раз сбрасывает rank 0
+    auto start = std::chrono::high_resolution_clock::now();
+    written = (::close(c_fd) == 0) && written;
+    times[0] += seconds_since(start);
+    int all_written = 0;
+    MPI_Allreduce(&written, &all_written, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    if (rank == 0) {
+        start = std::chrono::high_resolution_clock::now();
+        if (!all_written || !C.open(path_c, false, error) || !C.sync()) {
+            std::cerr << (all_written ? error : path_c + ": write failed") << "\n";
+            all_written = 0;
         }
+        times[0] += seconds_since(start);
     }
+    MPI_Bcast(&all_written, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    double total = seconds_since(start_total);
+    if (!all_written) return false;
+
+    double max_times[2], total_bytes;
+    MPI_Reduce(times, max_times, 2, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&io_bytes, &total_bytes, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
 
     if (rank == 0) {
-        std::cout << "Parallel time (" << size << " processes): " << par_time << " seconds\n";
-        std::cout << "Parallel result (first 5x5):\n";
-        print_matrix_part(C_par, M, P);
-        bool correct = true;
-        for (int i = 0; i < M; ++i) {
-            for (int j = 0; j < P; ++j) {
-                if (std::abs(C_seq[i][j] - C_par[i][j]) > 1e-6) {
-                    correct = false;
-                    break;
-                }
-            }
+        std::mt19937 gen(7);
+        double max_error = 0.0;
+        for (int s = 0; s < CHECK_SAMPLES; ++s) {
+            int i = gen() % m, j = gen() % p;
+            double expected = 0.0;
+            for (int k = 0; k < n; ++k) expected += A.row(i)[k] * B.row(k)[j];
+            max_error = std::max(max_error, std::abs(expected - C.row(i)[j]) / std::max(1.0, std::abs(expected)));
+        }
+        std::cout << "Out-of-core multiply " << m << "x" << n << " * " << n << "x" << p << " on " << size
+                  << " processes, panel " << panel << "\n";
+        std::cout << "Parallel time: " << total << " seconds (" << 2.0 * m * n * p / total / 1e9 << " GFLOP/s)\n";
+        std::cout << "Max per rank: I/O " << max_times[0] << " s (" << total_bytes / (1024.0 * 1024.0) << " MB in total, "
+                  << total_bytes / max_times[0] / 1e9 << " GB/s), compute " << max_times[1] << " s ("
+                  << 2.0 * m * n * p / max_times[1] / 1e9 << " GFLOP/s)\n";
+        std::cout << "Results match (" << CHECK_SAMPLES << " sampled entries): " << (max_error <= 1e-9 ? "Yes" : "No")
+                  << " (max relative error " << max_error << ")\n";
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    MPI_Init(&argc, &argv);
+
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    select_dot_kernels();
+
+    std::string algorithm = "rows";
+    std::string precision = "double";
+    std::string path_a, path_b, path_c;
+    int m = M, n = N, p = P, panel = PANEL, chunk_rows = CHUNK_ROWS;
+    bool valid = true;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--algorithm" && has_value) {
+            algorithm = argv[++i];
+        } else if (arg == "--m" && has_value) {
+            m = std::atoi(argv[++i]);
+        } else if (arg == "--n" && has_value) {
+            n = std::atoi(argv[++i]);
+        } else if (arg == "--p" && has_value) {
+            p = std::atoi(argv[++i]);
+        } else if (arg == "--panel" && has_value) {
+            panel = std::atoi(argv[++i]);
+        } else if (arg == "--precision" && has_value) {
+            precision = argv[++i];
+        } else if (arg == "--chunk" && has_value) {
+            chunk_rows = std::atoi(argv[++i]);
+        } else if (arg == "--a" && has_value) {
+            path_a = argv[++i];
+        } else if (arg == "--b" && has_value) {
+            path_b = argv[++i];
+        } else if (arg == "--c" && has_value) {
+            path_c = argv[++i];
+        } else {
+            valid = false;
+        }
+    }
+    if (algorithm != "rows" && algorithm != "summa" && algorithm != "file") valid = false;
+    if (m < 1 || n < 1 || p < 1 || panel < 1 || chunk_rows < 1) valid = false;
+    if (precision != "double" && precision != "float" && precision != "bf16" && precision != "int8") valid = false;
+    // SUMMA считает только в double
+    if (algorithm == "summa" && precision != "double") valid = false;
+    // Файловый режим читает файлы double и требует все три пути
+    if (algorithm == "file" && (precision != "double" || path_a.empty() || path_b.empty() || path_c.empty())) valid = false;
+    if (!valid) {
+        if (rank == 0) {
+            std::cerr << "Usage: " << argv[0] << " [--algorithm rows|summa|file] [--m ROWS_A] [--n COLS_A] [--p COLS_B]\n"
+                      << "       [--chunk ROWS] [--precision double|float|bf16|int8] (rows) [--panel K] (summa, file)\n"
+                      << "       [--a A.bin --b B.bin --c C.bin] (file)\n";
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+    bool ok = true;
+    if (algorithm == "summa") {
+        ok = run_summa(rank, size, m, n, p, panel);
+    } else if (algorithm == "file") {
+        ok = run_file(rank, size, m, n, p, panel, path_a, path_b, path_c);
+    } else {
+        if (precision == "float") {
+            run_rows<float, float>(rank, size, m, n, p, chunk_rows, "float");
+        } else if (precision == "bf16") {
+            run_rows<bf16, float>(rank, size, m, n, p, chunk_rows, "bf16/float");
+        } else if (precision == "int8") {
+            run_rows<int8_t, int32_t>(rank, size, m, n, p, chunk_rows, "int8/int32");
+        } else {
+            run_rows<double, double>(rank, size, m, n, p, chunk_rows, "double");
         }
-        std::cout << "Results match: " << (correct ? "Yes" : "No") << "\n";
     }
 
     MPI_Finalize();
-    return 0;
+    return ok ? 0 : 1;
 }
\ No newline at end of file
@@ -0,0 +1,190 @@
+#pragma once
+// Автотюнер, общий для программ: настройки ядра по корзинам размера задачи в файле настроек машины.
+// Поиск покоординатный: число потоков, затем расписание с порцией, затем плитка
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <thread>
+#include <omp.h>
+#include <unistd.h>
+
+// Параметры ядра, подобранные автотюнером: потоки (0 - все доступные), расписание OpenMP и порция
+// для schedule(runtime) (0 - порция по умолчанию), размер плитки (0 - встроенный размер ядра)
+struct TuneConfig {
+    int threads = 0;
+    omp_sched_t schedule = omp_sched_static;
+    int chunk = 0;
+    int tile = 0;
+};
+
+// Что из настроек ядро действительно читает: ядрам на std::thread не нужно расписание,
+// плитки перебираются только у блочных ядер. max_threads 0 - все доступные потоки
+struct TuneSpace {
+    int max_threads = 0;
+    bool schedules = true;
+    std::vector<int> tiles;
+};
+
+inline const char* schedule_name(omp_sched_t schedule) {
+    switch (schedule) {
+        case omp_sched_dynamic: return "dynamic";
+        case omp_sched_guided: return "guided";
+        default: return "static";
+    }
+}
+
+inline bool parse_schedule(const std::string& name, omp_sched_t& schedule) {
+    if (name == "static") schedule = omp_sched_static;
+    else if (name == "dynamic") schedule = omp_sched_dynamic;
+    else if (name == "guided") schedule = omp_sched_guided;
+    else return false;
+    return true;
+}
+
+// Корзина размера задачи - floor(log2(n)): настройки для 1000 и 1023 общие, для 2048 уже свои
+inline int size_bucket(long long n) {
+    int bucket = 0;
+    while (n > 1) {
+        n >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+// Все доступные потоки: у OpenMP-программ с учётом OMP_NUM_THREADS, без OpenMP - число ядер
+inline int available_threads() {
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return std::max(1u, std::thread::hardware_concurrency());
+#endif
+}
+
+inline int config_threads(const TuneConfig& config) {
+    return config.threads > 0 ? config.threads : available_threads();
+}
+
+// Файл настроек у каждой машины свой: program.hostname.tune в текущем каталоге.
+// Строка файла: ядро, корзина, потоки, расписание, порция, плитка; '#' - комментарий
+inline std::string default_tune_path(const char* program) {
+    char host[256] = "localhost";
+    gethostname(host, sizeof(host) - 1);
+    return std::string(program) + "." + host + ".tune";
+}
+
+class TuneCache {
+private:
+    std::map<std::pair<std::string, int>, TuneConfig> entries;
+
+public:
+    std::string path;
+
+    bool load() {
+        std::ifstream in(path);
+        if (!in) return false;
+        std::string line;
+        while (std::getline(in, line)) {
+            if (line.empty() || line[0] == '#') continue;
+            std::istringstream fields(line);
+            std::string kernel, schedule;
+            int bucket;
+            TuneConfig config;
+            if (fields >> kernel >> bucket >> config.threads >> schedule >> config.chunk >> config.tile
+                && parse_schedule(schedule, config.schedule)) {
+                entries[{ kernel, bucket }] = config;
+            }
+        }
+        return true;
+    }
+
+    bool save() const {
+        std::ofstream out(path);
+        out << "# kernel bucket threads schedule chunk tile\n";
+        for (const auto& entry : entries) {
+            const TuneConfig& c = entry.second;
+            out << entry.first.first << " " << entry.first.second << " " << c.threads << " "
+                << schedule_name(c.schedule) << " " << c.chunk << " " << c.tile << "\n";
+        }
+        return (bool)out;
+    }
+
+    size_t size() const { return entries.size(); }
+
+    // Настройки ядра для задачи размера n; если их нет, остаётся fallback
+    TuneConfig lookup(const std::string& kernel, long long n, const TuneConfig& fallback) const {
+        auto it = entries.find({ kernel, size_bucket(n) });
+        return it == entries.end() ? fallback : it->second;
+    }
+
+    void store(const std::string& kernel, long long n, const TuneConfig& config) {
+        entries[{ kernel, size_bucket(n) }] = config;
+    }
+};
+
+// Покоординатный поиск от текущих настроек по осям space.
+// run выполняет ядро один раз с заданными настройками, из двух замеров берётся меньший
+inline TuneConfig autotune(const char* kernel, TuneConfig best, const TuneSpace& space,
+                           const std::function<void(const TuneConfig&)>& run) {
+    auto measure = [&](const TuneConfig& config) {
+        double best_time = 1e30;
+        for (int r = 0; r < 2; r++) {
+            auto start = std::chrono::high_resolution_clock::now();
+            run(config);
+            best_time = std::min(best_time, std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count());
+        }
+        return best_time;
+    };
+    double best_time = measure(best);
+    auto consider = [&](const TuneConfig& candidate) {
+        double time = measure(candidate);
+        if (time < best_time) {
+            best_time = time;
+            best = candidate;
+        }
+    };
+
+    int max_threads = space.max_threads > 0 ? space.max_threads : available_threads();
+    std::vector<int> threads;
+    for (int t = 1; t < max_threads; t *= 2) threads.push_back(t);
+    threads.push_back(max_threads);
+    TuneConfig base = best;
+    for (int t : threads) {
+        TuneConfig candidate = base;
+        candidate.threads = t;
+        consider(candidate);
+    }
+
+    if (space.schedules) {
+        const std::pair<omp_sched_t, int> schedules[] = {
+            { omp_sched_static, 0 }, { omp_sched_static, 1 }, { omp_sched_static, 16 },
+            { omp_sched_dynamic, 1 }, { omp_sched_dynamic, 4 }, { omp_sched_dynamic, 16 },
+            { omp_sched_guided, 1 }, { omp_sched_guided, 4 },
+        };
+        base = best;
+        for (const auto& schedule : schedules) {
+            TuneConfig candidate = base;
+            candidate.schedule = schedule.first;
+            candidate.chunk = schedule.second;
+            consider(candidate);
+        }
+    }
+
+    base = best;
+    for (int tile : space.tiles) {
+        TuneConfig candidate = base;
+        candidate.tile = tile;
+        consider(candidate);
+    }
+
+    std::cout << "Tuned " << kernel << ": " << best_time << " s with " << config_threads(best) << " threads";
+    if (space.schedules) std::cout << ", schedule " << schedule_name(best.schedule) << "," << best.chunk;
+    if (best.tile > 0) std::cout << ", tile " << best.tile;
+    std::cout << "\n";
+    return best;
+}
@@ -0,0 +1,51 @@
+#pragma once
+// Воспроизводимая сумма: массив режется на блоки по DET_BLOCK элементов независимо от числа потоков
+// или процессов, блоки суммируются с компенсацией, а их частичные суммы складываются деревом в фиксированном порядке
+#include <vector>
+#include <cmath>
+
+#define DET_BLOCK 4096
+
+// Частичная сумма с компенсацией Ноймайера: значение и накопленная ошибка округления.
+// Порядок операций задан явно, поэтому собирать без -ffast-math
+struct CompensatedSum {
+    double sum = 0.0;
+    double error = 0.0;
+};
+
+inline void neumaier_add(CompensatedSum& acc, double x) {
+    double t = acc.sum + x;
+    acc.error += std::abs(acc.sum) >= std::abs(x) ? (acc.sum - t) + x : (x - t) + acc.sum;
+    acc.sum = t;
+}
+
+// Сложение двух частичных сумм: TwoSum даёт точную ошибку округления, к ней добавляются ошибки обеих
+inline CompensatedSum combine(const CompensatedSum& a, const CompensatedSum& b) {
+    CompensatedSum r;
+    r.sum = a.sum + b.sum;
+    double bv = r.sum - a.sum;
+    r.error = ((a.sum - (r.sum - bv)) + (b.sum - bv)) + (a.error + b.error);
+    return r;
+}
+
+// Четыре независимые цепочки внутри блока (элемент i идёт в цепочку i % 4), затем их сумма в фиксированном порядке
+inline CompensatedSum block_sum(const double* data, int count) {
+    CompensatedSum lanes[4];
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        for (int l = 0; l < 4; ++l) neumaier_add(lanes[l], data[i + l]);
+    }
+    for (; i < count; ++i) neumaier_add(lanes[i % 4], data[i]);
+    return combine(combine(lanes[0], lanes[1]), combine(lanes[2], lanes[3]));
+}
+
+// Попарное дерево над суммами блоков: форма дерева зависит только от числа блоков
+inline CompensatedSum tree_reduce(std::vector<CompensatedSum>& parts) {
+    if (parts.empty()) return CompensatedSum();
+    for (size_t width = 1; width < parts.size(); width *= 2) {
+        for (size_t i = 0; i + width < parts.size(); i += 2 * width) {
+            parts[i] = combine(parts[i], parts[i + width]);
+        }
+    }
+    return parts[0];
+}
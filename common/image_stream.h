@@ -0,0 +1,120 @@
+#pragma once
+// Потоковая запись изображений без внешних библиотек, общая для программ с безголовым режимом
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdint>
+#include <algorithm>
+
+// Построчная запись RGB-изображения в PPM (P6) или PNG без внешних библиотек.
+// PNG пишется несжатыми блоками deflate, поэтому каждую порцию строк можно сразу отдать в файл.
+class ImageStream {
+private:
+    FILE* file = nullptr;
+    bool png = false;
+    int width = 0;
+    long long remaining = 0;
+    bool header_written = false;
+    uint32_t adler_a = 1, adler_b = 0;
+
+    static uint32_t crc32(const unsigned char* data, size_t length, uint32_t crc = 0xFFFFFFFFu) {
+        static uint32_t table[256];
+        static bool ready = false;
+        if (!ready) {
+            for (uint32_t n = 0; n < 256; n++) {
+                uint32_t c = n;
+                for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                table[n] = c;
+            }
+            ready = true;
+        }
+        for (size_t i = 0; i < length; i++) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        return crc;
+    }
+
+    static void put_be32(std::vector<unsigned char>& out, uint32_t value) {
+        out.push_back(value >> 24);
+        out.push_back(value >> 16);
+        out.push_back(value >> 8);
+        out.push_back(value);
+    }
+
+    void write_chunk(const char* type, const std::vector<unsigned char>& data) {
+        std::vector<unsigned char> head;
+        put_be32(head, (uint32_t)data.size());
+        head.insert(head.end(), type, type + 4);
+        uint32_t crc = crc32(&head[4], 4);
+        crc = crc32(data.data(), data.size(), crc) ^ 0xFFFFFFFFu;
+        std::vector<unsigned char> tail;
+        put_be32(tail, crc);
+        std::fwrite(head.data(), 1, head.size(), file);
+        std::fwrite(data.data(), 1, data.size(), file);
+        std::fwrite(tail.data(), 1, tail.size(), file);
+    }
+
+public:
+    bool open(const std::string& path, int image_width, int image_height) {
+        file = std::fopen(path.c_str(), "wb");
+        if (!file) return false;
+        png = path.size() >= 4 && path.compare(path.size() - 4, 4, ".png") == 0;
+        width = image_width;
+        remaining = (long long)image_height * (1 + 3LL * image_width);
+        if (!png) {
+            std::fprintf(file, "P6\n%d %d\n255\n", image_width, image_height);
+            return true;
+        }
+        static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        std::fwrite(signature, 1, 8, file);
+        std::vector<unsigned char> ihdr;
+        put_be32(ihdr, image_width);
+        put_be32(ihdr, image_height);
+        ihdr.insert(ihdr.end(), { 8, 2, 0, 0, 0 });
+        write_chunk("IHDR", ihdr);
+        return true;
+    }
+
+    void write_rows(const unsigned char* rgb, int rows) {
+        if (!png) {
+            std::fwrite(rgb, 3, (size_t)rows * width, file);
+            return;
+        }
+        // Строка PNG - байт фильтра 0 и пиксели; данные режутся на хранимые блоки deflate по 65535 байт
+        std::vector<unsigned char> raw;
+        raw.reserve((size_t)rows * (1 + 3 * (size_t)width));
+        for (int r = 0; r < rows; r++) {
+            raw.push_back(0);
+            raw.insert(raw.end(), rgb + (size_t)r * width * 3, rgb + (size_t)(r + 1) * width * 3);
+        }
+        for (unsigned char byte : raw) {
+            adler_a = (adler_a + byte) % 65521;
+            adler_b = (adler_b + adler_a) % 65521;
+        }
+
+        std::vector<unsigned char> idat;
+        if (!header_written) {
+            idat.insert(idat.end(), { 0x78, 0x01 });
+            header_written = true;
+        }
+        for (size_t offset = 0; offset < raw.size(); offset += 65535) {
+            size_t length = std::min<size_t>(65535, raw.size() - offset);
+            remaining -= length;
+            idat.push_back(remaining == 0 ? 1 : 0);
+            idat.push_back(length & 0xFF);
+            idat.push_back(length >> 8);
+            idat.push_back(~length & 0xFF);
+            idat.push_back((~length >> 8) & 0xFF);
+            idat.insert(idat.end(), raw.begin() + offset, raw.begin() + offset + length);
+        }
+        write_chunk("IDAT", idat);
+    }
+
+    bool close() {
+        if (png) {
+            std::vector<unsigned char> adler;
+            put_be32(adler, (adler_b << 16) | adler_a);
+            write_chunk("IDAT", adler);
+            write_chunk("IEND", std::vector<unsigned char>());
+        }
+        return std::fclose(file) == 0;
+    }
+};
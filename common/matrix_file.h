@@ -0,0 +1,160 @@
+#pragma once
+// Двоичные файлы матриц, общие для программ умножения: формат, отображение в память и генератор элементов
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Двоичный файл матрицы: заголовок MATRIX_HEADER_SIZE байт, за ним данные без разделителей.
+// В заголовке - размеры, тип элементов и порядок хранения; файл целиком отображается в память через mmap
+#define MATRIX_MAGIC "MATBIN01"
+#define MATRIX_HEADER_SIZE 64
+#define DTYPE_FLOAT64 0
+#define DTYPE_FLOAT32 1
+#define LAYOUT_ROW_MAJOR 0
+#define LAYOUT_COL_MAJOR 1
+
+struct MatrixFileHeader {
+    char magic[8];
+    uint32_t dtype;
+    uint32_t layout;
+    int64_t rows;
+    int64_t cols;
+    uint64_t data_offset;
+    char reserved[24];
+};
+static_assert(sizeof(MatrixFileHeader) == MATRIX_HEADER_SIZE, "matrix header must be 64 bytes");
+
+// Отображённая матрица double построчно; строки читаются и пишутся прямо через data
+class MappedMatrix {
+private:
+    int fd = -1;
+    unsigned char* base = nullptr;
+    size_t length = 0;
+
+    bool map(bool writable, std::string& error) {
+        void* address = mmap(nullptr, length, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+        if (address == MAP_FAILED) {
+            error = std::string("mmap failed: ") + std::strerror(errno);
+            return false;
+        }
+        base = (unsigned char*)address;
+        data = (double*)(base + MATRIX_HEADER_SIZE);
+        return true;
+    }
+
+public:
+    int64_t rows = 0, cols = 0;
+    double* data = nullptr;
+
+    MappedMatrix() = default;
+    MappedMatrix(const MappedMatrix&) = delete;
+    MappedMatrix& operator=(const MappedMatrix&) = delete;
+    ~MappedMatrix() { close(); }
+
+    bool open(const std::string& path, bool writable, std::string& error) {
+        fd = ::open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+        if (fd < 0) {
+            error = path + ": " + std::strerror(errno);
+            return false;
+        }
+        MatrixFileHeader header;
+        struct stat info;
+        if (fstat(fd, &info) != 0 || pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header)
+            || std::memcmp(header.magic, MATRIX_MAGIC, 8) != 0) {
+            error = path + ": not a matrix file";
+            return false;
+        }
+        // Формат допускает float32 и хранение по столбцам, умножение пока читает только double построчно
+        if (header.dtype != DTYPE_FLOAT64 || header.layout != LAYOUT_ROW_MAJOR || header.data_offset != MATRIX_HEADER_SIZE) {
+            error = path + ": only row-major float64 matrices are supported";
+            return false;
+        }
+        rows = header.rows;
+        cols = header.cols;
+        length = MATRIX_HEADER_SIZE + (size_t)rows * cols * sizeof(double);
+        if (rows < 1 || cols < 1 || (size_t)info.st_size < length) {
+            error = path + ": truncated matrix file";
+            return false;
+        }
+        return map(writable, error);
+    }
+
+    // Новый файл нужного размера; данные заполняет вызывающий через data
+    bool create(const std::string& path, int64_t new_rows, int64_t new_cols, std::string& error) {
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            error = path + ": " + std::strerror(errno);
+            return false;
+        }
+        rows = new_rows;
+        cols = new_cols;
+        length = MATRIX_HEADER_SIZE + (size_t)rows * cols * sizeof(double);
+        MatrixFileHeader header = {};
+        std::memcpy(header.magic, MATRIX_MAGIC, 8);
+        header.dtype = DTYPE_FLOAT64;
+        header.layout = LAYOUT_ROW_MAJOR;
+        header.rows = rows;
+        header.cols = cols;
+        header.data_offset = MATRIX_HEADER_SIZE;
+        if (ftruncate(fd, (off_t)length) != 0 || pwrite(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header)) {
+            error = path + ": " + std::strerror(errno);
+            return false;
+        }
+        return map(true, error);
+    }
+
+    double* row(int64_t i) const { return data + (size_t)i * cols; }
+
+    // Подсказка ядру для строк [first, first + count): MADV_WILLNEED - начать чтение заранее,
+    // MADV_DONTNEED - страницы больше не нужны. Границы расширяются до целых страниц
+    void advise(int64_t first, int64_t count, int advice) const {
+        if (count <= 0) return;
+        size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        size_t begin = (size_t)((unsigned char*)row(first) - base) / page * page;
+        size_t end = std::min(length, (size_t)((unsigned char*)row(first + count) - base));
+        madvise(base + begin, end - begin, advice);
+    }
+
+    bool sync() const { return msync(base, length, MS_SYNC) == 0; }
+
+    void close() {
+        if (base) munmap(base, length);
+        if (fd >= 0) ::close(fd);
+        base = nullptr;
+        data = nullptr;
+        fd = -1;
+    }
+};
+
+// Элемент задаётся хешем координат: файл или полосу матрицы может заполнять любой поток или ранг,
+// без матрицы в памяти и без обмена
+inline double matrix_element(uint64_t seed, int64_t i, int64_t j) {
+    uint64_t z = seed + (uint64_t)i * 0x9E3779B97F4A7C15ULL + (uint64_t)j * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    return (z >> 11) * (10.0 / 9007199254740992.0);
+}
+
+// Открывает файл матрицы, а если его нет - создаёт rows x cols и заполняет по seed
+inline bool open_or_generate(MappedMatrix& mat, const std::string& path, int rows, int cols, uint64_t seed,
+                             std::string& error) {
+    if (access(path.c_str(), F_OK) == 0) return mat.open(path, false, error);
+    if (!mat.create(path, rows, cols, error)) return false;
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static)
+#endif
+    for (int64_t i = 0; i < mat.rows; ++i) {
+        double* row = mat.row(i);
+        for (int64_t j = 0; j < mat.cols; ++j) row[j] = matrix_element(seed, i, j);
+    }
+    std::cout << "Generated " << path << " (" << rows << "x" << cols << ")\n";
+    return mat.sync();
+}
@@ -0,0 +1,150 @@
+#pragma once
+// Типы хранения пониженной точности для обобщённых ядер: double, float, bf16 с накоплением во float,
+// int8 с накоплением в int32. Скалярные произведения - переносимое и AVX2 с выбором при запуске
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define SIMD_KERNELS 1
+#else
+#define SIMD_KERNELS 0
+#endif
+
+// bf16 - старшие 16 бит float: тот же диапазон порядка, 8 бит мантиссы
+struct bf16 {
+    uint16_t bits;
+};
+
+inline bf16 to_bf16(float x) {
+    uint32_t u;
+    std::memcpy(&u, &x, sizeof(u));
+    u += 0x7FFF + ((u >> 16) & 1);  // округление к ближайшему чётному
+    return { (uint16_t)(u >> 16) };
+}
+
+inline float from_bf16(bf16 x) {
+    uint32_t u = (uint32_t)x.bits << 16;
+    float f;
+    std::memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+template<typename Acc, typename T> inline Acc widen(T x) { return (Acc)x; }
+template<> inline float widen<float, bf16>(bf16 x) { return from_bf16(x); }
+
+// Масштаб квантования: для int8 x ~ q * scale при |q| <= 127, для остальных типов 1
+template<typename T> inline double storage_scale(const std::vector<double>&) { return 1.0; }
+template<> inline double storage_scale<int8_t>(const std::vector<double>& data) {
+    double max_abs = 0.0;
+    for (double x : data) max_abs = std::max(max_abs, std::abs(x));
+    return max_abs > 0.0 ? max_abs / 127.0 : 1.0;
+}
+
+template<typename T> inline T encode(double x, double) { return (T)x; }
+template<> inline bf16 encode<bf16>(double x, double) { return to_bf16((float)x); }
+template<> inline int8_t encode<int8_t>(double x, double scale) { return (int8_t)std::lround(x / scale); }
+
+template<typename T> inline std::vector<T> encode_all(const std::vector<double>& data, double scale) {
+    std::vector<T> out(data.size());
+    for (size_t i = 0; i < data.size(); i++) out[i] = encode<T>(data[i], scale);
+    return out;
+}
+
+// Скалярное произведение с хранением в T и накоплением в Acc
+template<typename T, typename Acc>
+inline Acc dot_scalar(const T* a, const T* b, int n) {
+    Acc sum = 0;
+    for (int i = 0; i < n; i++) {
+        sum += widen<Acc>(a[i]) * widen<Acc>(b[i]);
+    }
+    return sum;
+}
+
+#if SIMD_KERNELS
+__attribute__((target("avx2,fma")))
+inline double dot_avx2(const double* a, const double* b, int n) {
+    __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), acc0);
+        acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4), acc1);
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(acc0, acc1));
+    double sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    for (; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+__attribute__((target("avx2,fma")))
+inline float dot_avx2(const float* a, const float* b, int n) {
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+    }
+    float lanes[8];
+    _mm256_storeu_ps(lanes, _mm256_add_ps(acc0, acc1));
+    float sum = 0.0f;
+    for (int l = 0; l < 8; l++) sum += lanes[l];
+    for (; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+// bf16 расширяется до float сдвигом на 16 бит, накопление в float
+__attribute__((target("avx2,fma")))
+inline float dot_avx2(const bf16* a, const bf16* b, int n) {
+    __m256 acc = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i wa = _mm256_slli_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(a + i))), 16);
+        __m256i wb = _mm256_slli_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(b + i))), 16);
+        acc = _mm256_fmadd_ps(_mm256_castsi256_ps(wa), _mm256_castsi256_ps(wb), acc);
+    }
+    float lanes[8];
+    _mm256_storeu_ps(lanes, acc);
+    float sum = 0.0f;
+    for (int l = 0; l < 8; l++) sum += lanes[l];
+    for (; i < n; i++) sum += from_bf16(a[i]) * from_bf16(b[i]);
+    return sum;
+}
+
+// int8 расширяется до int16, pmaddwd складывает пары произведений сразу в int32
+__attribute__((target("avx2,fma")))
+inline int32_t dot_avx2(const int8_t* a, const int8_t* b, int n) {
+    __m256i acc = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i wa = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(a + i)));
+        __m256i wb = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(b + i)));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(wa, wb));
+    }
+    int32_t lanes[8];
+    _mm256_storeu_si256((__m256i*)lanes, acc);
+    int32_t sum = 0;
+    for (int l = 0; l < 8; l++) sum += lanes[l];
+    for (; i < n; i++) sum += (int32_t)a[i] * b[i];
+    return sum;
+}
+#endif
+
+inline bool use_avx2 = false;
+
+template<typename T, typename Acc>
+inline Acc dot(const T* a, const T* b, int n) {
+#if SIMD_KERNELS
+    if (use_avx2) return dot_avx2(a, b, n);
+#endif
+    return dot_scalar<T, Acc>(a, b, n);
+}
+
+inline void select_dot_kernels() {
+#if SIMD_KERNELS
+    use_avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}